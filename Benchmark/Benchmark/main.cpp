@@ -0,0 +1,918 @@
+// BENCHMARK
+// Lexer throughput on generated SIGNAL programs, one row per token mix.
+// The same seed gives the same sources, so runs on different builds are
+// comparable. With --intern, the names of every source are interned
+// into one InternTable from 1, 2, 4, ... threads at once instead. With
+// --flow, tokens are handed to a consumer in batch, by next_token() and,
+// in C++20 builds, by a coroutine, over one big source and over many
+// small ones. With --check, the parallel and stream lexers are compared
+// with a sequential run instead, on comments that span their cuts, and
+// so is lexing again after LexerAutomaton::rewind(). With
+// --edit, keystrokes are replayed through an IncrementalLexer on sources
+// of 100 KB, 1 MB and 10 MB. With --allocations, the allocations of
+// Lexer::run and of handing its results to a Parser are counted.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "lexer.h"
+#include "lexer_automaton.h"
+#include "lexer_generator.h"
+#include "lexer_incremental.h"
+#include "lexer_intern.h"
+#include "lexer_parallel.h"
+#include "lexer_scan.h"
+#include "lexer_stream.h"
+#include "parser.h"
+#include "predefined_lexem.h"
+#include "signal_generator.h"
+
+#define STREQ(a, b) (strcmp((a), (b)) == 0)
+#define INVALID_KEY 100
+#define KEYERROR(keystr, reason)                                             \
+  std::cout << "Wrong use of key " << keystr << ": " << reason << std::endl; \
+  return INVALID_KEY;
+using namespace translator;
+
+// Every allocation of the program goes through these, for
+// --allocations. They only count while `counting` is set, so other modes
+// pay a load per allocation and threads don't contend on the counters.
+std::atomic<bool> counting(false);
+std::atomic<std::uint64_t> allocation_count(0);
+std::atomic<std::uint64_t> allocation_bytes(0);
+
+void* operator new(std::size_t size) {
+  if (counting.load(std::memory_order_relaxed)) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+  }
+  if (void* p = std::malloc(size != 0 ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) { return operator new(size); }
+// GCC takes free() inlined next to a new-expression for a mismatch
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+struct NamedMix {
+  const char* name;
+  SourceMix mix;
+};
+
+// each preset leans on one lexer state
+const NamedMix presets[] = {
+    {"mixed", {6, 0.1, 0.3, 0.5, 0.05}},
+    {"identifiers", {16, 0.0, 0.0, 0.2, 0.0}},
+    {"comments", {6, 0.9, 0.3, 0.2, 0.0}},
+    {"numbers", {2, 0.0, 0.9, 0.5, 0.0}},
+    {"operators", {1, 0.0, 0.2, 0.9, 0.0}},
+    {"emails", {6, 0.0, 0.3, 0.2, 0.8}},
+};
+
+struct Measure {
+  std::size_t tokens = 0;
+  std::uint64_t errors = 0;
+  // sum of the codes and name lengths of the tokens, for --flow
+  std::uint64_t checksum = 0;
+  double best = 0;
+  double median = 0;
+};
+
+/// Lex a source `repeats` times with a fresh automaton each time
+Measure measure(const std::string& source, const int repeats) {
+  const auto& predefined = predefined_lexem();
+  std::ostringstream errors;
+  std::vector<double> seconds;
+  Measure result;
+  for (int i = 0; i < repeats; ++i) {
+    LexerAutomaton automaton(source.data(), source.data() + source.size(),
+                             predefined);
+    automaton.set_error_output(errors);
+    auto started = std::chrono::steady_clock::now();
+    LexemData data = automaton.run();
+    seconds.push_back(std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - started)
+                          .count());
+    result.tokens = data.tokens.size();
+    result.errors = data.diagnostics.total();
+  }
+  std::sort(seconds.begin(), seconds.end());
+  result.best = seconds.front();
+  result.median = seconds[seconds.size() / 2];
+  return result;
+}
+
+/// How --flow hands tokens to their consumer
+enum class Flow {
+  // run() keeps them all, then they are read
+  Batch,
+  // next_token() lexes one per call
+  Pull,
+  // a coroutine lexes one per resume
+  Coroutine
+};
+
+const char* flow_name(const Flow flow) {
+  switch (flow) {
+    case Flow::Batch:
+      return "batch";
+    case Flow::Pull:
+      return "pull";
+    default:
+      return "coroutine";
+  }
+}
+
+/// Lex a source `copies` times in a row with one automaton, reading every
+/// token's code and name as a parser would, `repeats` times. tokens and
+/// checksum are of all copies.
+Measure measure_flow(const std::string& source,
+                     const std::size_t copies,
+                     const Flow flow,
+                     const int repeats) {
+  const char* begin = source.data();
+  const char* end = source.data() + source.size();
+  std::ostringstream errors;
+  std::vector<double> seconds;
+  Measure result;
+  for (int i = 0; i < repeats; ++i) {
+    LexerAutomaton automaton(begin, end, predefined_lexem());
+    automaton.set_error_output(errors);
+    std::size_t tokens = 0;
+    std::uint64_t checksum = 0;
+    LexemToken token;
+    auto started = std::chrono::steady_clock::now();
+    for (std::size_t copy = 0; copy < copies; ++copy) {
+      automaton.reset(begin, end);
+      switch (flow) {
+        case Flow::Batch: {
+          LexemData data = automaton.run();
+          for (std::size_t j = 0; j < data.tokens.size(); ++j) {
+            checksum += static_cast<std::uint64_t>(data.tokens.symbol(j)) +
+                        data.tokens.name(j).size();
+          }
+          tokens += data.tokens.size();
+        } break;
+        case Flow::Pull:
+          while (automaton.next_token(token)) {
+            checksum +=
+                static_cast<std::uint64_t>(token.symbol) + token.name.size();
+            ++tokens;
+          }
+          break;
+        case Flow::Coroutine: {
+#ifdef TRANSLATOR_COROUTINES
+          TokenGenerator generator = lex_tokens(automaton);
+          while (generator.next(token)) {
+            checksum +=
+                static_cast<std::uint64_t>(token.symbol) + token.name.size();
+            ++tokens;
+          }
+#endif
+        } break;
+      }
+    }
+    seconds.push_back(std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - started)
+                          .count());
+    result.tokens = tokens;
+    result.checksum = checksum;
+  }
+  std::sort(seconds.begin(), seconds.end());
+  result.best = seconds.front();
+  result.median = seconds[seconds.size() / 2];
+  return result;
+}
+
+/// Constants, identifiers and emails of a source, in order
+std::vector<std::string> source_names(const std::string& source) {
+  std::ostringstream errors;
+  LexerAutomaton automaton(source.data(), source.data() + source.size(),
+                           predefined_lexem());
+  automaton.set_error_output(errors);
+  LexemData data = automaton.run();
+  std::vector<std::string> names;
+  for (std::size_t i = 0; i < data.tokens.size(); ++i) {
+    if (!token_code::is(data.tokens.symbol(i), TokenKind::Predefined)) {
+      names.emplace_back(data.tokens.name(i));
+    }
+  }
+  return names;
+}
+
+/// Intern all the names from every one of `threads` threads into a fresh
+/// table, `repeats` times. Each thread starts at its own place in the
+/// names, so first sights and repeats of a name race from the start.
+/// tokens counts the names interned by all threads in one run.
+Measure measure_intern(const std::vector<std::string>& names,
+                       const unsigned threads,
+                       const int repeats) {
+  std::vector<double> seconds;
+  Measure result;
+  for (int i = 0; i < repeats; ++i) {
+    InternTable table;
+    auto worker = [&](unsigned self) {
+      const std::size_t first = names.size() / threads * self;
+      for (std::size_t j = 0; j < names.size(); ++j) {
+        std::size_t at = first + j;
+        if (at >= names.size()) {
+          at -= names.size();
+        }
+        table.intern(TokenKind::Identifier, names[at]);
+      }
+    };
+    auto started = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) {
+      pool.emplace_back(worker, t);
+    }
+    worker(0);
+    for (auto& x : pool) {
+      x.join();
+    }
+    seconds.push_back(std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - started)
+                          .count());
+    result.tokens = names.size() * threads;
+    result.errors = table.size();
+  }
+  std::sort(seconds.begin(), seconds.end());
+  result.best = seconds.front();
+  result.median = seconds[seconds.size() / 2];
+  return result;
+}
+
+/// How --check lexes a source
+enum class Front { Sequential, Parallel, Stream };
+
+const char* front_name(const Front front) {
+  switch (front) {
+    case Front::Sequential:
+      return "sequential";
+    case Front::Parallel:
+      return "parallel";
+    default:
+      return "stream";
+  }
+}
+
+/// The errors, then the tables print_results writes, of a source lexed
+/// one way. The parallel lexer runs on 4 threads, the stream lexer in
+/// 4 KB windows, so a source of a few megabytes is cut many times.
+std::string lex_report(const std::string& source, const Front front) {
+  auto predefined = std::make_shared<const translator::PropertyContainer>(
+      predefined_lexem());
+  const char* begin = source.data();
+  const char* end = source.data() + source.size();
+  std::ostringstream errors;
+  std::ostringstream tables;
+  switch (front) {
+    case Front::Sequential: {
+      LexerAutomaton automaton(begin, end, predefined);
+      automaton.set_error_output(errors);
+      print_results(automaton.run(), tables);
+    } break;
+    case Front::Parallel: {
+      ParallelLexer parallel(begin, end, predefined, 4);
+      parallel.set_error_output(errors);
+      print_results(parallel.run(), tables);
+    } break;
+    case Front::Stream: {
+      StreamLexer stream(predefined, 4096);
+      stream.set_error_output(errors);
+      std::istringstream input(source);
+      stream.run(input, tables);
+    } break;
+  }
+  return errors.str() + tables.str();
+}
+
+/// A program of about `bytes` bytes whose middle is one comment, with
+/// bad UTF-8 on every line of it, so every chunk and window cut falls
+/// inside it. With `open`, the comment runs to the end of the source.
+std::string spanning_comment(const std::size_t bytes, const bool open) {
+  std::string out = "PROGRAM P;\nBEGIN\n";
+  while (out.size() < bytes / 8) {
+    out += "X := 1;\n";
+  }
+  out += "(* caf\xC3\xA9\n";
+  while (out.size() < bytes / 8 * 7) {
+    out += "  stray \xFF, cut \xC3 and fine \xE2\x82\xAC bytes\n";
+  }
+  if (open) {
+    return out;
+  }
+  out += "*)\n";
+  while (out.size() < bytes) {
+    out += "Y := 2;\n";
+  }
+  out += "END.\n";
+  return out;
+}
+
+/// Tokens pulled with next_token() from the automaton's read position
+/// on, as rows of the token table, after the errors met
+std::string pull_report(LexerAutomaton& automaton) {
+  std::ostringstream errors;
+  std::ostringstream tokens;
+  automaton.set_error_output(errors);
+  LexemToken token;
+  while (automaton.next_token(token)) {
+    print_lexem_row(token.name, token.symbol, token.row, token.column,
+                    tokens);
+  }
+  return errors.str() + tokens.str();
+}
+
+/// Pull a few tokens, rewind and lex the source again, by pulling or
+/// with run(). Whether that gives the tokens, codes and errors of a
+/// fresh automaton.
+bool rewind_same(const std::string& source, const bool run) {
+  const char* begin = source.data();
+  const char* end = source.data() + source.size();
+  LexerAutomaton fresh(begin, end, predefined_lexem());
+  const std::string expected =
+      run ? lex_report(source, Front::Sequential) : pull_report(fresh);
+  LexerAutomaton automaton(begin, end, predefined_lexem());
+  std::ostringstream discarded;
+  automaton.set_error_output(discarded);
+  LexemToken token;
+  for (int i = 0; i < 16 && automaton.next_token(token); ++i) {
+  }
+  automaton.rewind();
+  if (!run) {
+    return pull_report(automaton) == expected;
+  }
+  std::ostringstream errors;
+  std::ostringstream tables;
+  automaton.set_error_output(errors);
+  print_results(automaton.run(), tables);
+  return errors.str() + tables.str() == expected;
+}
+
+/// Latency of IncrementalLexer::edit, for --edit
+struct EditMeasure {
+  std::size_t tokens = 0;
+  // best full lex of the source
+  double full = 0;
+  // mean seconds per keystroke typed into an identifier and deleted,
+  // and per edit adding a token after its first char and deleted, which
+  // moves the token arrays
+  double keystroke = 0;
+  double added = 0;
+  // the tokens matched a full run after the keystrokes and after every
+  // step of opening and closing a comment
+  bool verified = true;
+};
+
+/// Replace `removed` bytes at `offset` of the source with `text` and
+/// update the lexer. Returns the seconds the lexer took; the editor's
+/// own buffer update isn't counted.
+double apply_edit(IncrementalLexer& lexer,
+                  std::string& source,
+                  const std::size_t offset,
+                  const std::size_t removed,
+                  const std::string& text) {
+  source.replace(offset, removed, text);
+  auto started = std::chrono::steady_clock::now();
+  lexer.edit(source.data(), source.data() + source.size(),
+             SourceEdit{offset, removed, text.size()});
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       started)
+      .count();
+}
+
+/// Whether the lexer's tokens are the ones a full run over the source
+/// gives. Codes may differ after edits, so kinds and names are compared.
+bool same_tokens(IncrementalLexer& lexer, const std::string& source) {
+  std::ostringstream errors;
+  LexerAutomaton automaton(source.data(), source.data() + source.size(),
+                           predefined_lexem());
+  automaton.set_error_output(errors);
+  const LexemData expected = automaton.run();
+  const TokenStore& got = lexer.data().tokens;
+  const TokenStore& want = expected.tokens;
+  if (got.size() != want.size()) {
+    return false;
+  }
+  for (std::size_t i = 0; i < got.size(); ++i) {
+    if (token_code::kind(got.symbol(i)) != token_code::kind(want.symbol(i)) ||
+        got.name(i) != want.name(i) || got.row(i) != want.row(i) ||
+        got.column(i) != want.column(i)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// Lex a source with an IncrementalLexer `repeats` times, then replay
+/// `keystrokes` pairs of typing and deleting a char after the first one
+/// of an identifier in its middle, and as many adding and deleting a
+/// token there. Last, a comment
+/// is opened a third of the way in, closed at two thirds, and both are
+/// taken back, each step checked against a full run.
+EditMeasure measure_edit(std::string source,
+                         const std::size_t keystrokes,
+                         const int repeats) {
+  std::ostringstream errors;
+  IncrementalLexer lexer;
+  lexer.set_error_output(errors);
+  // no reallocation while typing
+  source.reserve(source.size() + 16);
+  std::vector<double> seconds;
+  EditMeasure result;
+  for (int i = 0; i < repeats; ++i) {
+    auto started = std::chrono::steady_clock::now();
+    lexer.run(source.data(), source.data() + source.size());
+    seconds.push_back(std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - started)
+                          .count());
+  }
+  std::sort(seconds.begin(), seconds.end());
+  result.full = seconds.front();
+  result.tokens = lexer.size();
+
+  const TokenStore& tokens = lexer.data().tokens;
+  std::size_t target = tokens.size() / 2;
+  while (target < tokens.size() &&
+         !token_code::is(tokens.symbol(target), TokenKind::Identifier)) {
+    ++target;
+  }
+  if (target == tokens.size()) {
+    result.verified = false;
+    return result;
+  }
+  const std::size_t at = lexer.offset(target) + 1;
+  double typing = 0;
+  double adding = 0;
+  for (std::size_t k = 0; k < keystrokes; ++k) {
+    typing += apply_edit(lexer, source, at, 0, "x");
+    typing += apply_edit(lexer, source, at, 1, "");
+  }
+  for (std::size_t k = 0; k < keystrokes; ++k) {
+    adding += apply_edit(lexer, source, at, 0, " x");
+    adding += apply_edit(lexer, source, at, 2, "");
+  }
+  result.keystroke = typing / static_cast<double>(2 * keystrokes);
+  result.added = adding / static_cast<double>(2 * keystrokes);
+  result.verified = same_tokens(lexer, source);
+
+  const std::size_t open = lexer.offset(tokens.size() / 3);
+  const std::size_t close = lexer.offset(tokens.size() / 3 * 2) + 2;
+  apply_edit(lexer, source, open, 0, "(*");
+  result.verified = result.verified && same_tokens(lexer, source);
+  apply_edit(lexer, source, close, 0, "*)");
+  result.verified = result.verified && same_tokens(lexer, source);
+  apply_edit(lexer, source, close, 2, "");
+  result.verified = result.verified && same_tokens(lexer, source);
+  apply_edit(lexer, source, open, 2, "");
+  result.verified = result.verified && same_tokens(lexer, source);
+  return result;
+}
+
+/// Allocations made while a call ran
+struct Allocations {
+  std::uint64_t count = 0;
+  std::uint64_t bytes = 0;
+};
+
+template <class F>
+Allocations count_allocations(F&& f) {
+  const std::uint64_t count = allocation_count.load();
+  const std::uint64_t bytes = allocation_bytes.load();
+  counting = true;
+  f();
+  counting = false;
+  return {allocation_count.load() - count, allocation_bytes.load() - bytes};
+}
+
+/// Allocations of Lexer::run on a source held in memory, and of handing
+/// its results to a Parser, for --allocations
+struct HandoffMeasure {
+  std::size_t tokens = 0;
+  Allocations lex;
+  Allocations handoff;
+};
+
+HandoffMeasure measure_handoff(const std::string& source) {
+  std::ostringstream errors;
+  Lexer lexer;
+  lexer.set_error_output(errors);
+  HandoffMeasure result;
+  LexemData data;
+  result.lex = count_allocations([&] {
+    data = lexer.run(source.data(), source.data() + source.size());
+  });
+  result.tokens = data.tokens.size();
+  std::unique_ptr<Parser> parser;
+  result.handoff = count_allocations(
+      [&] { parser = std::make_unique<Parser>(std::move(data)); });
+  return result;
+}
+
+/// Parse a chance in [0, 1]; false if it isn't one
+bool parse_chance(const std::string& s, double& value) {
+  char* end = nullptr;
+  value = std::strtod(s.c_str(), &end);
+  return !s.empty() && *end == '\0' && value >= 0 && value <= 1;
+}
+
+int main(int argc, char* argv[]) {
+  // parse command-line args
+  // print help
+  if (argc == 2 && STREQ(argv[1], "help")) {
+    std::cout << "supported args:\
+      help              - prints help(--help)\
+      -s megabytes      - size of every generated source(--size), 16 by default\
+      -r repeats        - runs per source(--repeats), best and median are reported, 5 by default\
+      --seed number     - generator seed, 1 by default\
+      -m mix            - preset to run(--mix): mixed, identifiers, comments, numbers, operators, emails or all(default)\
+      --format csv|json - output format, csv by default\
+      -g filename       - only write the source of the first mix to a file(--generate)\
+      --intern threads  - intern the names of every source from 1, 2, 4, ... up to that many threads(64 at most) instead of lexing\
+      --flow            - compare handing tokens over in batch, by next_token() and by a coroutine(C++20 builds), on one source of the size and on 4 KB sources lexed as many times\
+      --edit            - time keystrokes re-lexed by IncrementalLexer on sources of 100 KB, 1 MB and 10 MB, checking the tokens against full runs; fails with exit code 1 if they differ\
+      --allocations     - count the allocations of Lexer::run and of moving its results into a Parser, on a tenth of the size and on the size; fails with exit code 1 if the move allocates more for the bigger source\
+      --check           - check that the parallel and stream lexers give what a sequential run does on comments spanning their cuts, and that lexing again after a rewind does; fails with exit code 1 if not\
+    a custom mix instead of the presets:\
+      --identifier-length n, --comments p, --numbers p, --operators p, --emails p";
+    return 0;
+  }
+  //parse rest
+  std::string* pending = nullptr;
+  std::string size = "16";
+  std::string repeats = "5";
+  std::string seed = "1";
+  std::string mix_name = "all";
+  std::string format = "csv";
+  std::string generate_file;
+  std::string intern_threads;
+  std::string identifier_length;
+  std::string comments;
+  std::string numbers;
+  std::string operators;
+  std::string emails;
+  bool flow = false;
+  bool check = false;
+  bool edit = false;
+  bool allocations = false;
+  for (int i = 1; i < argc; ++i) {
+    // if it's a key
+    if (*(argv[i]) == '-') {
+      if (pending) {
+        // no argument specified for the previous key
+        KEYERROR(argv[i - 1], "No argument specified!")
+      }
+      if (STREQ(argv[i], "-s") || STREQ(argv[i], "--size")) {
+        pending = &size;
+      } else if (STREQ(argv[i], "-r") || STREQ(argv[i], "--repeats")) {
+        pending = &repeats;
+      } else if (STREQ(argv[i], "--seed")) {
+        pending = &seed;
+      } else if (STREQ(argv[i], "-m") || STREQ(argv[i], "--mix")) {
+        pending = &mix_name;
+      } else if (STREQ(argv[i], "--format")) {
+        pending = &format;
+      } else if (STREQ(argv[i], "-g") || STREQ(argv[i], "--generate")) {
+        pending = &generate_file;
+      } else if (STREQ(argv[i], "--intern")) {
+        pending = &intern_threads;
+      } else if (STREQ(argv[i], "--flow")) {
+        flow = true;
+      } else if (STREQ(argv[i], "--edit")) {
+        edit = true;
+      } else if (STREQ(argv[i], "--allocations")) {
+        allocations = true;
+      } else if (STREQ(argv[i], "--check")) {
+        check = true;
+      } else if (STREQ(argv[i], "--identifier-length")) {
+        pending = &identifier_length;
+      } else if (STREQ(argv[i], "--comments")) {
+        pending = &comments;
+      } else if (STREQ(argv[i], "--numbers")) {
+        pending = &numbers;
+      } else if (STREQ(argv[i], "--operators")) {
+        pending = &operators;
+      } else if (STREQ(argv[i], "--emails")) {
+        pending = &emails;
+      } else {
+        KEYERROR(argv[i], "Invalid key!")
+      }
+    } else {
+      if (pending) {
+        // write an argument
+        *pending = argv[i];
+        pending = nullptr;
+      } else {
+        // no key
+        KEYERROR(argv[i], "Invalid key!")
+      }
+    }
+  }
+  if (pending) {
+    KEYERROR(argv[argc - 1], "No argument specified!")
+  }
+
+  char* end = nullptr;
+  const double megabytes = std::strtod(size.c_str(), &end);
+  if (*end != '\0' || !(megabytes > 0)) {
+    KEYERROR("-s", "Invalid size!")
+  }
+  const long repeat_count = std::strtol(repeats.c_str(), &end, 10);
+  if (*end != '\0' || repeat_count < 1) {
+    KEYERROR("-r", "Invalid number of repeats!")
+  }
+  const unsigned long long seed_value = std::strtoull(seed.c_str(), &end, 10);
+  if (*end != '\0' || seed.empty()) {
+    KEYERROR("--seed", "Invalid seed!")
+  }
+  if (format != "csv" && format != "json") {
+    KEYERROR("--format", "Unknown format!")
+  }
+  long max_threads = 0;
+  if (!intern_threads.empty()) {
+    max_threads = std::strtol(intern_threads.c_str(), &end, 10);
+    if (*end != '\0' || max_threads < 1 || max_threads > 64) {
+      KEYERROR("--intern", "Threads must be in [1, 64]!")
+    }
+  }
+
+  // presets to run, or one custom mix built on the mixed preset
+  std::vector<NamedMix> mixes;
+  const bool custom = !identifier_length.empty() || !comments.empty() ||
+                      !numbers.empty() || !operators.empty() ||
+                      !emails.empty();
+  if (custom) {
+    NamedMix x = presets[0];
+    x.name = "custom";
+    if (!identifier_length.empty()) {
+      const long n = std::strtol(identifier_length.c_str(), &end, 10);
+      if (*end != '\0' || n < 1) {
+        KEYERROR("--identifier-length", "Invalid length!")
+      }
+      x.mix.identifier_length = static_cast<std::size_t>(n);
+    }
+    if (!comments.empty() && !parse_chance(comments, x.mix.comments)) {
+      KEYERROR("--comments", "Chance must be in [0, 1]!")
+    }
+    if (!numbers.empty() && !parse_chance(numbers, x.mix.numbers)) {
+      KEYERROR("--numbers", "Chance must be in [0, 1]!")
+    }
+    if (!operators.empty() &&
+        (!parse_chance(operators, x.mix.operators) || x.mix.operators >= 1)) {
+      KEYERROR("--operators", "Chance must be in [0, 1)!")
+    }
+    if (!emails.empty() && !parse_chance(emails, x.mix.emails)) {
+      KEYERROR("--emails", "Chance must be in [0, 1]!")
+    }
+    mixes.push_back(x);
+  } else {
+    for (const auto& x : presets) {
+      if (mix_name == "all" || mix_name == x.name) {
+        mixes.push_back(x);
+      }
+    }
+    if (mixes.empty()) {
+      KEYERROR("-m", "Unknown mix!")
+    }
+  }
+
+  const auto bytes = static_cast<std::size_t>(megabytes * 1e6);
+  if (allocations) {
+    // the results are moved, never copied, so handing over ten times as
+    // many tokens must allocate exactly as much
+    bool passed = true;
+    if (format == "csv") {
+      std::cout << "mix,seed,bytes,tokens,lex_allocations,lex_bytes,"
+                   "handoff_allocations,handoff_bytes,result\n";
+    }
+    for (const auto& x : mixes) {
+      HandoffMeasure small;
+      for (const std::size_t handoff_bytes : {bytes / 10, bytes}) {
+        const std::string source =
+            SignalGenerator(x.mix, seed_value).generate(handoff_bytes);
+        const HandoffMeasure m = measure_handoff(source);
+        const bool big = handoff_bytes == bytes;
+        const bool same = !big || (m.handoff.count == small.handoff.count &&
+                                   m.handoff.bytes == small.handoff.bytes);
+        passed = passed && same;
+        if (!big) {
+          small = m;
+        }
+        if (format == "csv") {
+          std::cout << x.name << ',' << seed_value << ',' << source.size()
+                    << ',' << m.tokens << ',' << m.lex.count << ','
+                    << m.lex.bytes << ',' << m.handoff.count << ','
+                    << m.handoff.bytes << ',' << (same ? "ok" : "GROWS")
+                    << '\n';
+        } else {
+          std::cout << "{\"mix\":\"" << x.name << "\",\"seed\":"
+                    << seed_value << ",\"bytes\":" << source.size()
+                    << ",\"tokens\":" << m.tokens
+                    << ",\"lex_allocations\":" << m.lex.count
+                    << ",\"lex_bytes\":" << m.lex.bytes
+                    << ",\"handoff_allocations\":" << m.handoff.count
+                    << ",\"handoff_bytes\":" << m.handoff.bytes
+                    << ",\"result\":\"" << (same ? "ok" : "grows")
+                    << "\"}\n";
+        }
+      }
+    }
+    return passed ? 0 : 1;
+  }
+  if (edit) {
+    // sizes are fixed, so latencies compare across sizes
+    const std::size_t keystrokes = 1000;
+    bool passed = true;
+    if (format == "csv") {
+      std::cout << "mix,seed,bytes,tokens,keystrokes,full_lex_s,keystroke_us,"
+                   "add_token_us,verified\n";
+    }
+    for (const auto& x : mixes) {
+      for (const std::size_t edit_bytes : {100000, 1000000, 10000000}) {
+        const EditMeasure m = measure_edit(
+            SignalGenerator(x.mix, seed_value).generate(edit_bytes),
+            keystrokes, static_cast<int>(repeat_count));
+        passed = passed && m.verified;
+        if (format == "csv") {
+          std::cout << x.name << ',' << seed_value << ',' << edit_bytes << ','
+                    << m.tokens << ',' << 4 * keystrokes << ',' << m.full
+                    << ',' << m.keystroke * 1e6 << ',' << m.added * 1e6 << ','
+                    << (m.verified ? "ok" : "MISMATCH") << '\n';
+        } else {
+          std::cout << "{\"mix\":\"" << x.name << "\",\"seed\":"
+                    << seed_value << ",\"bytes\":" << edit_bytes
+                    << ",\"tokens\":" << m.tokens
+                    << ",\"keystrokes\":" << 4 * keystrokes
+                    << ",\"full_lex_s\":" << m.full
+                    << ",\"keystroke_us\":" << m.keystroke * 1e6
+                    << ",\"add_token_us\":" << m.added * 1e6
+                    << ",\"verified\":" << (m.verified ? "true" : "false")
+                    << "}\n";
+        }
+      }
+    }
+    return passed ? 0 : 1;
+  }
+  if (check) {
+    // at least 4 MB, so the parallel lexer makes 4 chunks
+    const std::size_t check_bytes = std::max<std::size_t>(bytes, 4 << 20);
+    bool passed = true;
+    std::cout << "source,front,result\n";
+    for (const bool open : {false, true}) {
+      const std::string source = spanning_comment(check_bytes, open);
+      const std::string expected = lex_report(source, Front::Sequential);
+      for (const Front f : {Front::Parallel, Front::Stream}) {
+        const bool same = lex_report(source, f) == expected;
+        passed = passed && same;
+        std::cout << (open ? "open comment" : "closed comment") << ','
+                  << front_name(f) << ',' << (same ? "ok" : "MISMATCH")
+                  << '\n';
+      }
+    }
+    // errors among the tokens pulled before the rewind
+    const std::string source =
+        "PROGRAM P; ? (* \xFF *)\n" +
+        SignalGenerator(presets[0].mix, seed_value).generate(1 << 16);
+    for (const bool run : {false, true}) {
+      const bool same = rewind_same(source, run);
+      passed = passed && same;
+      std::cout << "rewind," << (run ? "run" : "pull") << ','
+                << (same ? "ok" : "MISMATCH") << '\n';
+    }
+    return passed ? 0 : 1;
+  }
+  if (!generate_file.empty()) {
+    std::ofstream output(generate_file, std::ios::binary);
+    output << SignalGenerator(mixes[0].mix, seed_value).generate(bytes);
+    return 0;
+  }
+
+  if (max_threads > 0) {
+    // names interned per second by all threads together; distinct is the
+    // table size after a run
+    if (format == "csv") {
+      std::cout << "mix,seed,threads,names,distinct,repeats,best_s,median_s,"
+                   "names_per_s\n";
+    }
+    for (const auto& x : mixes) {
+      const std::vector<std::string> names =
+          source_names(SignalGenerator(x.mix, seed_value).generate(bytes));
+      for (unsigned threads = 1;
+           threads <= static_cast<unsigned>(max_threads); threads *= 2) {
+        const Measure m =
+            measure_intern(names, threads, static_cast<int>(repeat_count));
+        const double names_per_s = static_cast<double>(m.tokens) / m.best;
+        if (format == "csv") {
+          std::cout << x.name << ',' << seed_value << ',' << threads << ','
+                    << m.tokens << ',' << m.errors << ',' << repeat_count
+                    << ',' << m.best << ',' << m.median << ',' << names_per_s
+                    << '\n';
+        } else {
+          std::cout << "{\"mix\":\"" << x.name << "\",\"seed\":" << seed_value
+                    << ",\"threads\":" << threads << ",\"names\":" << m.tokens
+                    << ",\"distinct\":" << m.errors
+                    << ",\"repeats\":" << repeat_count
+                    << ",\"best_s\":" << m.best << ",\"median_s\":" << m.median
+                    << ",\"names_per_s\":" << names_per_s << "}\n";
+        }
+      }
+    }
+    return 0;
+  }
+
+  if (flow) {
+    // the huge source, then small ones lexed until as many bytes are done
+    std::vector<Flow> flows = {Flow::Batch, Flow::Pull};
+#ifdef TRANSLATOR_COROUTINES
+    flows.push_back(Flow::Coroutine);
+#endif
+    const std::size_t small_bytes = 4096;
+    if (format == "csv") {
+      std::cout << "mix,seed,bytes,copies,flow,tokens,repeats,best_s,"
+                   "median_s,mb_per_s,tokens_per_s,checksum\n";
+    }
+    for (const auto& x : mixes) {
+      for (const bool small : {false, true}) {
+        const std::string source = SignalGenerator(x.mix, seed_value)
+                                       .generate(small ? small_bytes : bytes);
+        const std::size_t copies =
+            small ? std::max<std::size_t>(1, bytes / source.size()) : 1;
+        for (const Flow f : flows) {
+          const Measure m = measure_flow(source, copies, f,
+                                         static_cast<int>(repeat_count));
+          const double mb_per_s =
+              static_cast<double>(source.size() * copies) / 1e6 / m.best;
+          const double tokens_per_s = static_cast<double>(m.tokens) / m.best;
+          if (format == "csv") {
+            std::cout << x.name << ',' << seed_value << ',' << source.size()
+                      << ',' << copies << ',' << flow_name(f) << ','
+                      << m.tokens << ',' << repeat_count << ',' << m.best
+                      << ',' << m.median << ',' << mb_per_s << ','
+                      << tokens_per_s << ',' << m.checksum << '\n';
+          } else {
+            std::cout << "{\"mix\":\"" << x.name << "\",\"seed\":"
+                      << seed_value << ",\"bytes\":" << source.size()
+                      << ",\"copies\":" << copies << ",\"flow\":\""
+                      << flow_name(f) << "\",\"tokens\":" << m.tokens
+                      << ",\"repeats\":" << repeat_count
+                      << ",\"best_s\":" << m.best
+                      << ",\"median_s\":" << m.median
+                      << ",\"mb_per_s\":" << mb_per_s
+                      << ",\"tokens_per_s\":" << tokens_per_s
+                      << ",\"checksum\":" << m.checksum << "}\n";
+          }
+        }
+      }
+    }
+    return 0;
+  }
+
+  if (format == "csv") {
+    std::cout << "mix,seed,bytes,tokens,errors,repeats,best_s,median_s,"
+                 "mb_per_s,tokens_per_s,kernels\n";
+  }
+  for (const auto& x : mixes) {
+    const std::string source =
+        SignalGenerator(x.mix, seed_value).generate(bytes);
+    const Measure m = measure(source, static_cast<int>(repeat_count));
+    const double mb_per_s = static_cast<double>(source.size()) / 1e6 / m.best;
+    const double tokens_per_s = static_cast<double>(m.tokens) / m.best;
+    if (format == "csv") {
+      std::cout << x.name << ',' << seed_value << ',' << source.size() << ','
+                << m.tokens << ',' << m.errors << ',' << repeat_count << ','
+                << m.best << ',' << m.median << ',' << mb_per_s << ','
+                << tokens_per_s << ',' << scan::kernels().name << '\n';
+    } else {
+      std::cout << "{\"mix\":\"" << x.name << "\",\"seed\":" << seed_value
+                << ",\"bytes\":" << source.size() << ",\"tokens\":" << m.tokens
+                << ",\"errors\":" << m.errors << ",\"repeats\":" << repeat_count
+                << ",\"best_s\":" << m.best << ",\"median_s\":" << m.median
+                << ",\"mb_per_s\":" << mb_per_s
+                << ",\"tokens_per_s\":" << tokens_per_s << ",\"kernels\":\""
+                << scan::kernels().name << "\"}\n";
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,149 @@
+/* Synthetic SIGNAL source generator */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace translator {
+
+/// Token mix of a generated program. Chances are in [0, 1].
+struct SourceMix {
+  // mean identifier length; lengths are spread over [1, 2 * mean - 1]
+  std::size_t identifier_length = 6;
+  // chance of a (* ... *) comment after a statement
+  double comments = 0.1;
+  // chance of an operand being an unsigned integer
+  double numbers = 0.3;
+  // chance of one more comparison or AND/OR after an operand, so the
+  // mean expression has 1 / (1 - operators) operands
+  double operators = 0.5;
+  // chance of a statement assigning an email instead of an expression
+  double emails = 0.0;
+};
+
+/// Writes SIGNAL programs of a given size:
+///   PROGRAM name; VAR declarations BEGIN statements END.
+/// The same seed and mix give the same text on every platform: only the
+/// raw mt19937_64 output is used, no library distributions.
+class SignalGenerator {
+ public:
+  SignalGenerator(const SourceMix& mix, const std::uint64_t seed)
+      : m_mix(mix), m_random(seed) {
+    if (m_mix.identifier_length == 0) {
+      m_mix.identifier_length = 1;
+    }
+  }
+
+  /// A program of at least `size` bytes
+  std::string generate(const std::size_t size) {
+    std::string out;
+    out.reserve(size + 256);
+    out += "PROGRAM ";
+    out += identifier();
+    out += ";\nVAR\n";
+    m_variables.clear();
+    for (int i = 0; i < variable_count; ++i) {
+      m_variables.push_back(identifier());
+      out += "  ";
+      out += m_variables.back();
+      out += " : INTEGER;\n";
+    }
+    out += "BEGIN\n";
+    while (out.size() < size) {
+      statement(out);
+    }
+    out += "END.\n";
+    return out;
+  }
+
+ private:
+  static constexpr int variable_count = 256;
+
+  std::uint64_t below(const std::uint64_t n) { return m_random() % n; }
+  bool chance(const double p) {
+    return static_cast<double>(m_random() >> 11) * (1.0 / 9007199254740992.0) <
+           p;
+  }
+
+  std::string identifier() {
+    static const char letters[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+    static const char alnum[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+    const std::size_t length = 1 + below(2 * m_mix.identifier_length - 1);
+    std::string s(1, letters[below(sizeof letters - 1)]);
+    while (s.size() < length) {
+      s += alnum[below(sizeof alnum - 1)];
+    }
+    return s;
+  }
+
+  void operand(std::string& out) {
+    if (chance(m_mix.numbers)) {
+      out += std::to_string(below(1000000));
+    } else {
+      out += m_variables[below(m_variables.size())];
+    }
+  }
+
+  void expression(std::string& out) {
+    static const char* const comparisons[] = {" < ", " <= ", " = ",
+                                              " <> ", " >= ", " > "};
+    static const char* const logicals[] = {" AND ", " OR "};
+    operand(out);
+    while (chance(m_mix.operators)) {
+      switch (below(4)) {
+        case 0:
+          out += logicals[below(2)];
+          out += "NOT ";
+          break;
+        case 1:
+          out += logicals[below(2)];
+          break;
+        default:
+          out += comparisons[below(6)];
+          break;
+      }
+      if (below(8) == 0) {
+        out += '[';
+        operand(out);
+        out += comparisons[below(6)];
+        operand(out);
+        out += ']';
+      } else {
+        operand(out);
+      }
+    }
+  }
+
+  void statement(std::string& out) {
+    out += "  ";
+    out += m_variables[below(m_variables.size())];
+    out += " := ";
+    if (chance(m_mix.emails)) {
+      out += identifier();
+      out += '@';
+      out += identifier();
+      out += '.';
+      out += identifier();
+    } else {
+      expression(out);
+    }
+    out += ";\n";
+    if (chance(m_mix.comments)) {
+      out += "  (*";
+      for (std::uint64_t words = 1 + below(12); words > 0; --words) {
+        out += ' ';
+        out += identifier();
+      }
+      out += " *)\n";
+    }
+  }
+
+  SourceMix m_mix;
+  std::mt19937_64 m_random;
+  std::vector<std::string> m_variables;
+};
+}  // namespace translator
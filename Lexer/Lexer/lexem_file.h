@@ -0,0 +1,231 @@
+/* Binary lexer output */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "lexer_data.h"
+
+namespace translator {
+
+/// Binary lexer output, an alternative to the printed tables.
+/// Layout, every section 8-byte aligned and in host byte order:
+///   LexemFileHeader
+///   LexemFileToken[token_count]
+///   std::uint64_t string_offsets[string_count + 1] into the chars
+///   char chars[]
+///   LexemFileCode[code_count]
+/// Token and code records refer to names by index in the string table.
+namespace lexem_file {
+constexpr char magic[8] = {'~', '~', 'L', 'E', 'X', 'B', 'I', 'N'};
+constexpr std::uint32_t version = 3;
+// reads back differently on a host of the other byte order
+constexpr std::uint32_t byte_order = 0x01020304;
+}  // namespace lexem_file
+
+struct LexemFileHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t byte_order;
+  std::uint64_t token_count;
+  std::uint64_t string_count;
+  std::uint64_t code_count;
+  std::uint64_t tokens_offset;
+  std::uint64_t strings_offset;
+  std::uint64_t chars_offset;
+  std::uint64_t codes_offset;
+  std::uint64_t size;
+};
+
+// codes are TokenCode: the kind in the high 32 bits, the index in the low
+struct LexemFileToken {
+  std::int64_t symbol;
+  std::uint32_t name;
+  std::uint32_t reserved;
+  std::int64_t row;
+  std::int64_t column;
+};
+
+struct LexemFileCode {
+  std::int64_t code;
+  std::uint32_t name;
+  std::uint32_t reserved;
+};
+
+/// Write results in the binary format with a single write
+inline void write_lexem_file(const LexemData& results, std::ostream& output) {
+  const TokenStore& tokens = results.tokens;
+  // token names keep their ids; code table names not used by any token
+  // are added after them
+  StringPool strings = tokens.names();
+  std::vector<LexemFileCode> codes;
+  results.lexem_codes.for_each([&](const std::string& lexem, TokenCode code) {
+    codes.push_back({code, strings.intern(lexem), 0});
+  });
+  std::size_t chars_size = 0;
+  for (std::size_t i = 0; i < strings.size(); ++i) {
+    chars_size += strings[static_cast<std::uint32_t>(i)].size();
+  }
+  auto align = [](std::uint64_t x) { return (x + 7) & ~std::uint64_t(7); };
+
+  LexemFileHeader header;
+  std::memcpy(header.magic, lexem_file::magic, sizeof header.magic);
+  header.version = lexem_file::version;
+  header.byte_order = lexem_file::byte_order;
+  header.token_count = tokens.size();
+  header.string_count = strings.size();
+  header.code_count = codes.size();
+  header.tokens_offset = align(sizeof header);
+  header.strings_offset =
+      align(header.tokens_offset + tokens.size() * sizeof(LexemFileToken));
+  header.chars_offset = align(header.strings_offset +
+                              (strings.size() + 1) * sizeof(std::uint64_t));
+  header.codes_offset = align(header.chars_offset + chars_size);
+  header.size = header.codes_offset + codes.size() * sizeof(LexemFileCode);
+
+  std::vector<char> buffer(static_cast<std::size_t>(header.size));
+  char* out = buffer.data();
+  std::memcpy(out, &header, sizeof header);
+  auto* records = reinterpret_cast<LexemFileToken*>(out + header.tokens_offset);
+  for (std::size_t i = 0; i < tokens.size(); ++i) {
+    LinePosition at = tokens.position(i);
+    records[i] = {tokens.symbol(i), tokens.name_id(i), 0, at.row, at.column};
+  }
+  auto* offsets =
+      reinterpret_cast<std::uint64_t*>(out + header.strings_offset);
+  char* chars = out + header.chars_offset;
+  std::uint64_t at = 0;
+  for (std::size_t i = 0; i < strings.size(); ++i) {
+    const std::string& s = strings[static_cast<std::uint32_t>(i)];
+    offsets[i] = at;
+    std::memcpy(chars + at, s.data(), s.size());
+    at += s.size();
+  }
+  offsets[strings.size()] = at;
+  if (!codes.empty()) {
+    std::memcpy(out + header.codes_offset, codes.data(),
+                codes.size() * sizeof(LexemFileCode));
+  }
+  output.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+}
+
+/// Check whether a byte range starts like a binary lexer output
+inline bool is_lexem_file(const char* begin, const char* end) {
+  return static_cast<std::size_t>(end - begin) >= sizeof lexem_file::magic &&
+         std::memcmp(begin, lexem_file::magic, sizeof lexem_file::magic) == 0;
+}
+
+/// Read-only view of a binary lexer output in memory, e.g. a mapped file.
+/// The range must outlive the view and be 8-byte aligned.
+class LexemFileView {
+ public:
+  /// Check the header and section bounds; error() says what's wrong
+  LexemFileView(const char* begin, const char* end) : m_begin(begin) {
+    const std::size_t size = static_cast<std::size_t>(end - begin);
+    if (!is_lexem_file(begin, end) || size < sizeof(LexemFileHeader)) {
+      m_error = "File is not a binary lexer output!";
+      return;
+    }
+    std::memcpy(&m_header, begin, sizeof m_header);
+    if (m_header.byte_order != lexem_file::byte_order) {
+      m_error = "Binary lexer output has another byte order!";
+    } else if (m_header.version != lexem_file::version) {
+      m_error = "Unsupported binary lexer output version!";
+    } else if (m_header.size != size || m_header.string_count >= size ||
+               !fits(m_header.tokens_offset, m_header.token_count,
+                     sizeof(LexemFileToken)) ||
+               !fits(m_header.strings_offset, m_header.string_count + 1,
+                     sizeof(std::uint64_t)) ||
+               !fits(m_header.codes_offset, m_header.code_count,
+                     sizeof(LexemFileCode)) ||
+               m_header.chars_offset > m_header.codes_offset ||
+               string_offsets()[m_header.string_count] >
+                   m_header.codes_offset - m_header.chars_offset) {
+      m_error = "Binary lexer output is truncated or damaged!";
+    }
+  }
+
+  bool valid() const { return m_error == nullptr; }
+  const char* error() const { return m_error; }
+
+  std::size_t token_count() const {
+    return static_cast<std::size_t>(m_header.token_count);
+  }
+  const LexemFileToken* tokens() const {
+    return reinterpret_cast<const LexemFileToken*>(m_begin +
+                                                   m_header.tokens_offset);
+  }
+  std::size_t string_count() const {
+    return static_cast<std::size_t>(m_header.string_count);
+  }
+  std::string_view string(std::size_t i) const {
+    const std::uint64_t* offsets = string_offsets();
+    return std::string_view(m_begin + m_header.chars_offset + offsets[i],
+                            static_cast<std::size_t>(offsets[i + 1] - offsets[i]));
+  }
+  std::size_t code_count() const {
+    return static_cast<std::size_t>(m_header.code_count);
+  }
+  const LexemFileCode* codes() const {
+    return reinterpret_cast<const LexemFileCode*>(m_begin +
+                                                  m_header.codes_offset);
+  }
+
+  /// Copy into lexer results; false if a record refers to a missing name
+  bool load(LexemData& results) const {
+    const std::size_t strings = string_count();
+    const std::uint64_t* offsets = string_offsets();
+    for (std::size_t i = 0; i < strings; ++i) {
+      if (offsets[i] > offsets[i + 1]) {
+        return false;
+      }
+    }
+    // string table index -> pool id, interned on first use
+    const std::uint32_t none = ~std::uint32_t(0);
+    std::vector<std::uint32_t> ids(strings, none);
+    const LexemFileToken* records = tokens();
+    results.tokens.reserve(token_count());
+    for (std::size_t i = 0; i < token_count(); ++i) {
+      const LexemFileToken& x = records[i];
+      if (x.name >= strings) {
+        return false;
+      }
+      if (ids[x.name] == none) {
+        ids[x.name] = results.tokens.intern(string(x.name));
+      }
+      results.tokens.emplace_back_id(x.symbol, ids[x.name], x.row, x.column);
+    }
+    const LexemFileCode* table = codes();
+    for (std::size_t i = 0; i < code_count(); ++i) {
+      if (table[i].name >= strings) {
+        return false;
+      }
+      results.lexem_codes.set(std::string(string(table[i].name)),
+                              table[i].code);
+    }
+    results.pool_constants();
+    return true;
+  }
+
+ private:
+  const std::uint64_t* string_offsets() const {
+    return reinterpret_cast<const std::uint64_t*>(m_begin +
+                                                  m_header.strings_offset);
+  }
+
+  /// Check that count records of a size fit at offset
+  bool fits(std::uint64_t offset,
+            std::uint64_t count,
+            std::uint64_t size) const {
+    return offset % 8 == 0 && offset <= m_header.size &&
+           count <= (m_header.size - offset) / size;
+  }
+
+  const char* m_begin;
+  LexemFileHeader m_header{};
+  const char* m_error = nullptr;
+};
+}  // namespace translator
@@ -2,49 +2,144 @@
 #include <fstream>
 #include <iostream>
 #include <iterator>
-
-
+#include <memory>
 #include <vector>
 #include "lexer_automaton.h"
 #include "lexer_data.h"
+#include "lexer_intern.h"
+#include "lexer_parallel.h"
 #include "lexer_property_container.h"
+#include "lexer_rules.h"
+#include "lexer_source.h"
+#include "lexer_stream.h"
+#include "predefined_lexem.h"
 
 namespace translator {
 
 /// Lexer Automaton wrapper that operates on a file
 class Lexer {
  public:
-  Lexer(const PropertyContainer predefined_lexem = PropertyContainer())
-      : m_predefined_lexem(predefined_lexem){};
+  Lexer(const PropertyContainer& predefined_lexem = translator::predefined_lexem())
+      : m_predefined_lexem(
+            std::make_shared<const PropertyContainer>(predefined_lexem)){};
 
   LexemData run(const std::string& filename) {
-    std::ifstream file(filename);
-    try {
-      file.exceptions(file.failbit);
-    } catch (const std::ifstream::failure& e) {
-      std::cout << "File I/O Error" << e.what() << '\n';
+    if (open(filename) == nullptr) {
       return LexemData();
     }
-    if (worker != nullptr) {
-      delete worker;
-    }
-    worker = new LexerAutomaton(file, m_predefined_lexem);
     return worker->run();
   }
 
+  /// Lex a source held in memory. The range is only read during the
+  /// call. One automaton serves every run, so lexing many small sources
+  /// costs little more than the lexing itself.
+  LexemData run(const char* begin, const char* end) {
+    return reuse_worker(begin, end)->run();
+  }
+
+  /// Prepare an automaton over the file without lexing it, for pulling
+  /// tokens with next_token(). Returns nullptr if the file can't be read.
+  /// The automaton stays valid until the next open() or run().
+  LexerAutomaton* open(const std::string& filename) {
+    if (!m_source.open(filename)) {
+      *m_error_output << "File I/O Error: cannot open " << filename << '\n';
+      return nullptr;
+    }
+    return reuse_worker(m_source.begin(), m_source.end());
+  }
+
+  /// Lex one file on several threads; 0 means one per hardware thread.
+  /// The result is the same as run() gives.
+  LexemData run_parallel(const std::string& filename, unsigned threads = 0) {
+    if (open(filename) == nullptr) {
+      return LexemData();
+    }
+    ParallelLexer parallel(m_source.begin(), m_source.end(),
+                           m_predefined_lexem, threads, m_rules);
+    parallel.set_error_output(*m_error_output);
+    parallel.set_diagnostic_limits(m_diagnostic_limits);
+    parallel.set_diagnostic_renderer(m_diagnostic_renderer);
+    parallel.set_intern_table(m_intern);
+    return parallel.run();
+  }
+
+  /// Lex a stream of any length, e.g. standard input, in a fixed window,
+  /// writing the tables print_results would to output as the tokens
+  /// come. Returns the number of tokens.
+  std::uint64_t run_stream(std::istream& input, std::ostream& output) {
+    StreamLexer stream(m_predefined_lexem, 1 << 20, m_rules);
+    stream.set_error_output(*m_error_output);
+    stream.set_diagnostic_limits(m_diagnostic_limits);
+    stream.set_diagnostic_renderer(m_diagnostic_renderer);
+    stream.set_intern_table(m_intern);
+    return stream.run(input, output);
+  }
+
   LexemData operator()(const std::string& filename) {
     return run(filename);
   }
 
-  LexemData last_results() {
-    if (worker == nullptr) {
-      return LexemData();
+  /// Stream lexer errors are printed to, std::cout by default
+  void set_error_output(std::ostream& output) { m_error_output = &output; }
+  /// How many lexer errors are kept and printed
+  void set_diagnostic_limits(const DiagnosticLimits& limits) {
+    m_diagnostic_limits = limits;
+  }
+  /// How lexer errors are printed, render_diagnostic_text by default
+  void set_diagnostic_renderer(DiagnosticRenderer renderer) {
+    m_diagnostic_renderer = renderer;
+  }
+  /// Share the codes of constants, identifiers and emails with every
+  /// lexer given the same table, so a name gets one code in all their
+  /// sources. nullptr numbers them per run again.
+  void set_intern_table(std::shared_ptr<InternTable> table) {
+    m_intern = std::move(table);
+  }
+
+  /// Codes every run starts with
+  std::shared_ptr<const PropertyContainer> predefined() const {
+    return m_predefined_lexem;
+  }
+
+  /// Lex with other token rules than signal_rules(). Returns false and
+  /// keeps the current rules if they don't compile.
+  bool set_rules(const TokenRules& rules) {
+    auto dfa = std::make_shared<LexerDfa>();
+    std::string error;
+    if (!dfa->build(rules, &error)) {
+      *m_error_output << "Rules Error: " << error << '\n';
+      return false;
     }
-    return worker->data();
+    m_rules = std::move(dfa);
+    worker.reset();
+    return true;
   }
 
  private:
-  PropertyContainer m_predefined_lexem;
-  LexerAutomaton *worker = nullptr;
+  /// Point the worker at a range, making it on first use
+  LexerAutomaton* reuse_worker(const char* begin, const char* end) {
+    if (worker == nullptr) {
+      worker = std::make_unique<LexerAutomaton>(begin, end, m_predefined_lexem,
+                                                m_rules);
+    } else {
+      worker->reset(begin, end);
+    }
+    worker->set_error_output(*m_error_output);
+    worker->set_diagnostic_limits(m_diagnostic_limits);
+    worker->set_diagnostic_renderer(m_diagnostic_renderer);
+    worker->set_intern_table(m_intern);
+    return worker.get();
+  }
+
+  std::shared_ptr<const PropertyContainer> m_predefined_lexem;
+  /// nullptr for signal_rules() of the predefined table
+  std::shared_ptr<const LexerDfa> m_rules;
+  /// Source of the last run, kept alive for the worker
+  SourceBuffer m_source;
+  std::unique_ptr<LexerAutomaton> worker;
+  std::ostream* m_error_output = &std::cout;
+  DiagnosticLimits m_diagnostic_limits;
+  DiagnosticRenderer m_diagnostic_renderer = render_diagnostic_text;
+  std::shared_ptr<InternTable> m_intern;
 };
 }  // namespace translator
@@ -1,9 +1,19 @@
 #pragma once
 #include <cctype>
+#include <cstdint>
 #include <iostream>
-#include <fstream>
+#include <iterator>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
+#include <cstring>
 #include "lexer_data.h"
+#include "lexer_intern.h"
+#include "lexer_rules.h"
+#include "lexer_scan.h"
+#include "lexer_utf8.h"
+#include "predefined_lexem.h"
 
 // grammar:
 // var 24
@@ -38,283 +48,613 @@ class PropertyContainer;
 
 namespace translator {
 
+/// Tokens of one chunk of a source, lexed without assigning codes.
+/// Offsets are relative to the chunk start.
+struct LexerChunk {
+  // symbols hold the fixed code of predefined lexems, -1 otherwise;
+  // tokens.lines() indexes the chunk
+  TokenStore tokens;
+  std::vector<TokenKind> kinds;
+  DiagnosticSink diagnostics;
+  // diagnostics [unpositioned_first, unpositioned_first +
+  // unpositioned_errors) were raised before the chunk's first token
+  // start; they refer to the position carried over from the previous
+  // chunk
+  std::size_t unpositioned_first = 0;
+  std::size_t unpositioned_errors = 0;
+  bool unpositioned(const std::size_t diagnostic) const {
+    return diagnostic >= unpositioned_first &&
+           diagnostic - unpositioned_first < unpositioned_errors;
+  }
+  // last token start, if the chunk has one
+  bool has_position = false;
+  std::size_t offset_start = 0;
+  // the chunk ends inside a comment, or another rule that spans lines
+  bool in_comment = false;
+  // lexing stopped before the end of the chunk
+  bool halted = false;
+};
+
+class IncrementalLexer;
+class ParallelLexer;
+class StreamLexer;
+
 /// Lexer Automaton
-/// This automaton acts like functor saving the file stream reference and data
-/// created in the process.
+/// This automaton acts like functor saving the source range and data
+/// created in the process. The range must outlive the automaton.
+/// Tokens are matched by a DFA compiled from token rules, by default
+/// signal_rules() of the predefined table. The source is UTF-8: a char
+/// no rule takes is one error however many bytes it has, the text of
+/// rules that take non-ASCII bytes, such as comments, is validated, and
+/// columns count chars.
 class LexerAutomaton {
  public:
   /// Lexer Automaton constructor
 
-  LexerAutomaton(std::ifstream& file,
+  LexerAutomaton(const char* begin,
+                 const char* end,
                  PropertyContainer predefined_lexem = PropertyContainer())
-      : m_file(file), m_data(predefined_lexem) {}
-  /// Invokes the main loop
-  auto run() { return lexer_loop(m_file); }
+      : LexerAutomaton(begin,
+                       end,
+                       std::make_shared<const PropertyContainer>(
+                           std::move(predefined_lexem))) {}
+  /// Shares the predefined table instead of copying it; runs only add
+  /// to an overlay on top of it. rules replace the SIGNAL rules.
+  LexerAutomaton(const char* begin,
+                 const char* end,
+                 std::shared_ptr<const PropertyContainer> predefined_lexem,
+                 std::shared_ptr<const LexerDfa> rules = nullptr)
+      : m_predefined(std::move(predefined_lexem)),
+        m_data(PropertyContainer(m_predefined)),
+        m_dfa(rules != nullptr ? std::move(rules)
+                               : signal_dfa(*m_predefined)),
+        m_scan(scan::kernels()),
+        m_begin(begin),
+        m_end(end) {
+    rewind();
+  }
+  /// Invokes the main loop and hands the results over; data() is left
+  /// empty. Every run starts over, so it may be called again.
+  LexemData run() { return lexer_loop(); }
   /// Operator overload that invokes main loop
   auto operator()() { return run(); }
 
-  /// Get last data
-  LexemData data() const { return m_data; }
+  /// Lex up to the next token and store it in token.
+  /// Returns false at the end of the source. Tokens pulled this way are
+  /// not kept in data(); only the code table grows. Their rows and
+  /// columns come from a line count kept just ahead of the last token.
+  /// Errors met on the way are printed before returning.
+  bool next_token(LexemToken& token) {
+    m_token = &token;
+    m_emitted = false;
+    while (!m_emitted && state != LexerState::Exit) {
+      step();
+    }
+    m_token = nullptr;
+    m_data.diagnostics.flush(*m_error_output, m_begin,
+                             [this](std::uint64_t offset) {
+                               return locate(static_cast<std::size_t>(offset));
+                             },
+                             !m_emitted);
+    if (m_emitted) {
+      LinePosition at = locate(m_offset_start);
+      token.row = at.row;
+      token.column = at.column;
+    }
+    return m_emitted;
+  }
+
+  /// Offset of the last pulled token from the start of the source
+  std::size_t token_offset() const { return m_offset_start; }
+
+  /// Stream lexer errors are printed to, std::cout by default
+  void set_error_output(std::ostream& output) { m_error_output = &output; }
+  /// How many lexer errors are kept and printed
+  void set_diagnostic_limits(const DiagnosticLimits& limits) {
+    m_diagnostic_limits = limits;
+    m_data.diagnostics.set_limits(limits);
+  }
+  /// How lexer errors are printed, render_diagnostic_text by default
+  void set_diagnostic_renderer(DiagnosticRenderer renderer) {
+    m_diagnostic_renderer = renderer;
+    m_data.diagnostics.set_renderer(renderer);
+  }
+  /// Take the codes of constants, identifiers and emails from a table
+  /// shared with other lexers instead of numbering them per run;
+  /// nullptr goes back to numbering them per run
+  void set_intern_table(std::shared_ptr<InternTable> table) {
+    m_intern = std::move(table);
+  }
+
+  /// Lex another range with the same automaton: drops the results and
+  /// codes of the last run and keeps the rules, the predefined table and
+  /// the buffers. The range must outlive the automaton.
+  void reset(const char* begin, const char* end) {
+    m_begin = begin;
+    m_end = end;
+    // run() moves the data out, so the overlay is rebuilt rather than
+    // cleared; it is empty and costs no copy of the predefined table
+    m_data.lexem_codes = PropertyContainer(m_predefined);
+    m_data.constants.clear();
+    m_identifier_count = 0;
+    m_num_constant_count = 0;
+    m_email_count = 0;
+    rewind();
+  }
+
+  /// Restart reading from the beginning of the source. The codes
+  /// assigned so far are kept, so names pulled again get them back and
+  /// new names the next free ones; kept tokens and errors are dropped,
+  /// as they are read again. run() starts over with fresh codes anyway.
+  void rewind() {
+    m_data.tokens.clear();
+    m_data.diagnostics.clear();
+    m_cursor = m_begin;
+    m_eof = false;
+    m_input_buffer.erase();
+    m_input_char = -1;
+    m_offset_start = 0;
+    m_line_pos = m_begin;
+    m_line_row = 0;
+    m_line_column = 0;
+    m_data.diagnostics.set_limits(m_diagnostic_limits);
+    m_data.diagnostics.set_renderer(m_diagnostic_renderer);
+    state = LexerState::Start;
+  }
+
+  /// Input iterator over tokens pulled with next_token
+  class iterator {
+   public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = LexemToken;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const LexemToken*;
+    using reference = const LexemToken&;
+
+    iterator() = default;
+    explicit iterator(LexerAutomaton* automaton) : m_automaton(automaton) {
+      ++*this;
+    }
+    reference operator*() const { return m_token; }
+    pointer operator->() const { return &m_token; }
+    iterator& operator++() {
+      if (!m_automaton->next_token(m_token)) {
+        m_automaton = nullptr;
+      }
+      return *this;
+    }
+    bool operator==(const iterator& rhs) const {
+      return m_automaton == rhs.m_automaton;
+    }
+    bool operator!=(const iterator& rhs) const { return !(*this == rhs); }
+
+   private:
+    LexerAutomaton* m_automaton = nullptr;
+    LexemToken m_token;
+  };
+
+  /// Tokens from the current read position on
+  iterator begin() { return iterator(this); }
+  iterator end() { return iterator(); }
+
+  /// Results built so far
+  const LexemData& data() const { return m_data; }
 
  private:
-  /// Describes lexer states.
+  /// Describes lexer states. Within a token the DFA state is used.
   enum LexerState {
+    // read the next char
     Start,
+    // a token starts at the char read
     Input,
-    Identifier,
-    Delimiter,
-    Whitespace,
-    BComment,
-    EComment,
-    Comment,
-    Number,
-    Error,
-    Exit,
-    //custom
-    EmailWebsiteName,
-    EmailEnd
+    Exit
   } state;
 
-  /// Read a char from a file
+  /// Read a char from the source range
   ///-1 means eof
-  void readchar(std::ifstream& file, char& c) {
-    try {
-      c = file.get();
-    } catch (const std::ifstream::failure&) {
+  inline void readchar(char& c) {
+    if (m_cursor == m_end) {
       c = -1;
+      m_eof = true;
       return;
     }
-    if (c == '\r') {
-      m_column = 0;
-    } else if (c == '\n') {
-      ++m_row;
-      m_column = 0;
+    c = *m_cursor++;
+  }
+
+  /// Row and column of the char at offset, counting lines on from the
+  /// last position asked for
+  LinePosition locate(const std::size_t offset) {
+    const char* at = m_begin + offset;
+    if (at < m_line_pos) {
+      m_line_pos = m_begin;
+      m_line_row = 0;
+      m_line_column = 0;
+    }
+    scan::LineInfo lines = m_scan.count_lines(m_line_pos, at + 1);
+    m_line_row += static_cast<std::int64_t>(lines.rows);
+    // continuation bytes take no column
+    if (lines.line_start != nullptr) {
+      m_line_column = at + 1 - lines.line_start;
     } else {
-      ++m_column;
+      m_line_column += at + 1 - m_line_pos;
     }
+    m_line_column -= static_cast<std::int64_t>(lines.continuations);
+    m_line_pos = at + 1;
+    return {m_line_row, m_line_column};
   }
 
-  /// Main lexer loop. Checks the symbols in file one by one and switches states
-  LexemData lexer_loop(std::ifstream& file) {
-    // TODO: clear previous run
-    std::string input_buffer;
-    char input_char = -1;
-    m_row_start = 0;
-    m_column_start = 0;
-    m_identifier_count = 1000;
-    m_num_constant_count = 500;
+  /// Point the automaton at a new range and continue from `at`, which
+  /// must be a token start or the beginning of the range. row and column
+  /// are the position before reading `at`. The code table and counters
+  /// are kept.
+  void resume(const char* begin,
+              const char* end,
+              const char* at,
+              const std::int64_t row,
+              const std::int64_t column) {
+    m_begin = begin;
+    m_end = end;
+    m_cursor = at;
+    m_eof = false;
+    m_input_buffer.erase();
+    m_input_char = -1;
+    m_line_pos = at;
+    m_line_row = row;
+    m_line_column = column;
     state = LexerState::Start;
+  }
+
+  /// Main lexer loop. Runs until the end of the source, keeping tokens
+  /// by offset; rows and columns come from a line index of the source
+  LexemData lexer_loop() {
+    reset(m_begin, m_end);
+    auto lines = std::make_shared<const LineIndex>(m_begin, m_end);
+    m_data.tokens.set_lines(lines);
     while (state != LexerState::Exit) {
-      switch (state) {
-        case LexerState::Start: {
-          if (file.eof()) {
-            state = LexerState::Exit;
-            break;
-          }
-          readchar(file, input_char);
-          state = LexerState::Input;
-        } break;
-        case LexerState::Input: {
-          m_column_start = m_column;
-          m_row_start = m_row;
-          // expected eof
-          if (input_char < 0) {
-            // expected eof
-            state = LexerState::Exit;
-          } else {
-            // process char
-            if (iswspace(input_char)) {
-              state = LexerState::Whitespace;
-            } else if (isalpha(input_char)) {
-              state = LexerState::Identifier;
-            } else if (isdigit(input_char)) {
-              state = LexerState::Number;
-            } else if (input_char == '(') {
-              state = LexerState::Comment;
-            } else if (m_data.lexem_codes.isallowed(input_char)) {
-              // other character
-              state = LexerState::Delimiter;
-            } else {
-              state = LexerState::Error;
-            }
-          }
-        } break;
-        case LexerState::Identifier: {
-          // read until not a letter or digit
-          do {
-            toupper(input_char);
-            input_buffer += input_char;
-            readchar(file, input_char);
-          } while ((input_char >= 0) && isalnum(input_char));
-          //custom
-          if (input_char == '@') {
-            state = LexerState::EmailWebsiteName;
-            break;
-          }
-          // find identifier in predefined list"
-          int identifier_code = m_data.lexem_codes[input_buffer];
-          if (identifier_code < 0) {
-            identifier_code = m_identifier_count++;
-          }
-          m_data.new_token(input_buffer, identifier_code, m_row_start, m_column_start);
-          input_buffer.erase();
-          state = LexerState::Input;
-        } break;
-        case LexerState::Delimiter: {
-          // find a delimiter
-          input_buffer += input_char;
-          int code = m_data.lexem_codes[input_buffer];
-          if (code >= 0 && input_buffer.find_first_of(":<>") == std::string::npos) {
-            m_data.new_token(input_buffer, code, m_row_start, m_column_start);
-          } else {
-            // read second char and search again
-            readchar(file, input_char);
-            if (input_char < 0) {
-              state = LexerState::Error;
-              break;
-            }
-            int code = m_data.lexem_codes[input_buffer + input_char];
-            if (code >= 0) {
-              m_data.new_token(input_buffer + input_char, code, m_row_start, m_column_start);
-            } else {
-              code = m_data.lexem_codes[input_buffer];
-              if (code >= 0) {
-                m_data.new_token(input_buffer, code, m_row_start, m_column_start);
-              } else {
-                state = LexerState::Error;
-                break;
-              }
-            }
-          }
-          input_buffer.erase();
-          state = LexerState::Start;
-        } break;
-        case LexerState::Whitespace: {
-          // read while whitespace
-          do {
-            readchar(file, input_char);
-          } while ((input_char >= 0) && iswspace(input_char));
-          state = LexerState::Input;
-        } break;
-        case LexerState::Number:
-          // read while number
-          {
-            do {
-              input_buffer += input_char;
-              readchar(file, input_char);
-            } while ((input_char >= 0) && isdigit(input_char));
-            int num_constant_code = m_data.lexem_codes[input_buffer];
-            if (num_constant_code < 0) {
-              num_constant_code = m_num_constant_count++;
-            }
-            m_data.new_token(input_buffer, m_num_constant_count, m_row_start,
-                             m_column_start);
-            input_buffer.erase();
-            state = LexerState::Input;
-          }
-          break;
-        case LexerState::BComment: {
-          // get next char
-          readchar(file, input_char);
-          if (input_char == '*' && !file.eof()) {
-            readchar(file, input_char);
-            state = LexerState::Comment;
-          } else {
-            state = LexerState::Error;
-          }
-        } break;
-        case LexerState::Comment: {
-          while (input_char != '*' && input_char) {
-            readchar(file, input_char);
-          }
-          if (input_char < 0) {
-            state = LexerState::Error;
-          } else {
-            state = LexerState::EComment;
-          }
-        } break;
-        case LexerState::EComment: {
-          readchar(file, input_char);
-          if (input_char >= 0) {
-            if (input_char != ')') {
-              state = LexerState::Comment;
-            } else {
-              state = LexerState::Start;
-            }
-          } else {
-            state = LexerState::Error;
-          }
-        } break;
-        case LexerState::Error: {
-          // TODO: process errors the good way
-          std::cout << "Lexer error:";
-          if (file.eof()) {
-            std::cout << "Unexpected end of file. \n";
-          } else {
-            std::cout << "Unknown identifier. \n";
-          }
-          std::cout << input_char << "(" << input_buffer << ")"
-                    << " at "
-                    << "[" << m_row_start << ", " << m_column_start << "]\n";
-          input_buffer.erase();
-          readchar(file, input_char);
-          state = LexerState::Input;
-        } break;
-        case LexerState::Exit:
-          // void
-          break;
-        //custom
-        case LexerState::EmailWebsiteName:
-          //read until dot or eof
-          do {
-            input_buffer += input_char;
-            readchar(file, input_char);
-          } while ((input_char >= 0) && isalnum(input_char) && input_char != '.');
-
-          if (input_char == '.') {
-            state = LexerState::EmailEnd;
-          } else {
-            state = LexerState::Error;
-          }
+      step();
+    }
+    m_data.diagnostics.flush(
+        *m_error_output, m_begin,
+        [&lines](std::uint64_t offset) { return lines->locate(offset); },
+        true);
+    return std::move(m_data);
+  }
+
+  /// Code of a token. A name seen before keeps its code; a new one gets
+  /// the next index of its kind, or its code in the shared table.
+  TokenCode assign_code(const TokenKind kind,
+                        const std::string& lexem,
+                        const TokenCode fixed_code) {
+    std::uint32_t* count = nullptr;
+    switch (kind) {
+      case TokenKind::Identifier:
+        count = &m_identifier_count;
+        break;
+      case TokenKind::Constant:
+        count = &m_num_constant_count;
+        break;
+      case TokenKind::Email:
+        count = &m_email_count;
+        break;
+      default:
+        return fixed_code;
+    }
+    const TokenCode code = m_data.lexem_codes.find(lexem);
+    if (code >= 0) {
+      return code;
+    }
+    const TokenCode fresh = m_intern != nullptr
+                                ? m_intern->intern(kind, lexem)
+                                : token_code::make(kind, (*count)++);
+    // a constant is converted once, when its spelling is first met
+    if (kind == TokenKind::Constant) {
+      m_data.constants.parse(fresh, lexem);
+    }
+    return fresh;
+  }
+
+  /// Register the token starting at m_offset_start and hand it to the
+  /// caller of next_token, or keep it by offset in the main loop.
+  /// In chunk mode the code is left for the stitch step.
+  void emit(const std::string& lexem,
+            const TokenKind kind,
+            const TokenCode fixed_code) {
+    m_emitted = true;
+    if (m_chunk != nullptr) {
+      m_chunk->tokens.emplace_back_at(fixed_code, lexem, m_offset_start);
+      m_chunk->kinds.push_back(kind);
+      return;
+    }
+    const TokenCode code = assign_code(kind, lexem, fixed_code);
+    if (m_token == nullptr) {
+      m_data.new_token_at(lexem, code, m_offset_start);
+      return;
+    }
+    m_data.add_lexem(lexem, code);
+    m_token->symbol = code;
+    m_token->name.assign(lexem);
+  }
+
+  /// Record an error on the token starting at m_offset_start, spanning
+  /// the chars read since; the first `prefix` of them were token text,
+  /// the last `input_size` bytes the char that failed it
+  void report(const DiagnosticCode code,
+              const std::size_t prefix,
+              const std::size_t input_size) {
+    const auto end = static_cast<std::uint64_t>(m_cursor - m_begin);
+    Diagnostic diagnostic{code,
+                          {m_input_char},
+                          1,
+                          m_offset_start,
+                          end - m_offset_start,
+                          prefix,
+                          1};
+    if (input_size > 1) {
+      std::memcpy(diagnostic.input, m_cursor - input_size, input_size);
+      diagnostic.input_size = static_cast<std::uint8_t>(input_size);
+    }
+    if (m_chunk == nullptr) {
+      m_data.diagnostics.report(diagnostic);
+      return;
+    }
+    if (!m_chunk->has_position && m_chunk->unpositioned_errors++ == 0) {
+      m_chunk->unpositioned_first = m_chunk->diagnostics.diagnostics().size();
+    }
+    m_chunk->diagnostics.report(diagnostic);
+  }
+
+  /// Lex the whole range as one chunk of a bigger source.
+  /// The range must end right after a '\n'; unless it is the last chunk,
+  /// its end is not treated as the end of the source.
+  LexerChunk lex_chunk(const bool in_comment, const bool last) {
+    LexerChunk chunk;
+    rewind();
+    m_chunk = &chunk;
+    m_chunk_last = last;
+    chunk.diagnostics.set_limits(m_diagnostic_limits);
+    chunk.tokens.set_lines(std::make_shared<const LineIndex>(m_begin, m_end));
+    if (in_comment) {
+      match(m_dfa->line_state(), m_begin);
+    }
+    while (state != LexerState::Exit) {
+      step();
+    }
+    chunk.offset_start = m_offset_start;
+    chunk.halted = !m_eof;
+    m_chunk = nullptr;
+    return chunk;
+  }
+
+  /// Run one state of the automaton
+  void step() {
+    switch (state) {
+      case LexerState::Start: {
+        if (m_eof) {
+          state = LexerState::Exit;
           break;
-        case LexerState::EmailEnd:
-        {
-          do {
-            input_buffer += input_char;
-            readchar(file, input_char);
-          } while ((input_char >= 0) && isalnum(input_char));
-
-          int email_code = m_data.lexem_codes[input_buffer];
-          if (email_code < 0) {
-            email_code = m_email_count++;
-          }
-
-          m_data.new_token(input_buffer, email_code, m_row_start,
-            m_column_start);
-          input_buffer.erase();
-
-          if (input_char < 0) {
-            state = LexerState::Exit;
-          } else {
-            state = LexerState::Input;
-          }
-
-        } break;
+        }
+        readchar(m_input_char);
+        state = LexerState::Input;
+      } break;
+      case LexerState::Input: {
+        m_offset_start = static_cast<std::size_t>(m_cursor - m_begin) - 1;
+        if (m_chunk != nullptr) {
+          m_chunk->has_position = true;
+        }
+        // expected eof; bytes >= 0x80 are negative chars too
+        if (m_eof) {
+          state = LexerState::Exit;
+        } else {
+          match(LexerDfa::start(), m_cursor - 1);
+        }
+      } break;
+      case LexerState::Exit:
+        // void
+        break;
+    }
+  }
+
+  /// Run the DFA from `dfa_state` over the source from m_cursor - 1 on,
+  /// for a token that starts at `from`, and act on where it stops
+  void match(int dfa_state, const char* from) {
+    const LexerDfa& dfa = *m_dfa;
+    const char* at = m_cursor - 1;
+    if (at < from) {
+      // a chunk starting inside a token
+      at = from;
+    }
+    while (at != m_end) {
+      const int next = dfa.next(dfa_state, *at);
+      if (next == LexerDfa::dead) {
+        break;
+      }
+      dfa_state = next;
+      at = skip(dfa.state(next), at + 1);
+    }
+    const LexerDfa::State& stopped = dfa.state(dfa_state);
+    if (at == m_end && stopped.spans && m_chunk != nullptr && !m_chunk_last) {
+      // the token goes on in the next chunk, which checks the rest of its
+      // text; a rule that spans lines takes every byte >= 0x80
+      validate(from, at);
+      m_cursor = m_end;
+      readchar(m_input_char);
+      m_chunk->in_comment = true;
+      state = LexerState::Exit;
+      return;
+    }
+    if (stopped.rule >= 0) {
+      const TokenRule& rule = dfa.rule(stopped.rule);
+      if (!(rule.flags & RuleEatsFollower) || !stopped.open) {
+        token(rule, stopped, from, at);
+        // the char it stopped at starts the next token
+        m_cursor = at;
+        state = LexerState::Start;
+        return;
       }
+      if (at != m_end && scan::is_ascii(*at)) {
+        token(rule, stopped, from, at);
+        m_cursor = at + 1;
+        state = LexerState::Start;
+        return;
+      }
+    }
+    // an error up to and including the char the DFA stopped at, all of
+    // its bytes if it is a multibyte one
+    m_cursor = at;
+    readchar(m_input_char);
+    if (m_eof && stopped.spans) {
+      // a comment left open is still checked, as it is when it spans
+      // chunks
+      validate(from, at);
+    }
+    DiagnosticCode code = m_eof ? DiagnosticCode::UnexpectedEof
+                                : DiagnosticCode::UnknownIdentifier;
+    std::size_t input_size = 1;
+    if (!m_eof && !scan::is_ascii(m_input_char)) {
+      input_size = utf8::sequence_length(at, m_end);
+      if (input_size == 0) {
+        code = DiagnosticCode::InvalidUtf8;
+        input_size = 1;
+      }
+      m_cursor = at + input_size;
+    }
+    report(code, stopped.text ? static_cast<std::size_t>(at - from) : 0,
+           input_size);
+    if (m_eof) {
+      state = LexerState::Input;
+    } else {
+      state = LexerState::Start;
     }
-    return m_data;
   }
 
+  /// Skip the self loop of a DFA state from `at` on
+  inline const char* skip(const LexerDfa::State& dfa_state, const char* at) {
+    switch (dfa_state.accel) {
+      case LexerDfa::AccelSpace:
+        return m_scan.skip_space(at, m_end);
+      case LexerDfa::AccelDigits:
+        return m_scan.skip_digits(at, m_end);
+      case LexerDfa::AccelAlnum:
+        return m_scan.skip_alnum(at, m_end);
+      case LexerDfa::AccelUntil: {
+        auto stop = static_cast<const char*>(std::memchr(
+            at, dfa_state.stop, static_cast<std::size_t>(m_end - at)));
+        return stop != nullptr ? stop : m_end;
+      }
+      default:
+        return at;
+    }
+  }
+
+  /// Record every byte of [from, to) that isn't part of a valid UTF-8
+  /// char; the span is no token's and keeps its position in chunk mode
+  void validate(const char* from, const char* to) {
+    for (const char* bad = utf8::find_invalid(from, to, m_scan); bad != to;
+         bad = utf8::find_invalid(bad + 1, to, m_scan)) {
+      Diagnostic diagnostic{DiagnosticCode::InvalidUtf8,
+                            {*bad},
+                            1,
+                            static_cast<std::uint64_t>(bad - m_begin),
+                            1,
+                            0,
+                            1};
+      if (m_chunk != nullptr) {
+        m_chunk->diagnostics.report(diagnostic);
+      } else {
+        m_data.diagnostics.report(diagnostic);
+      }
+    }
+  }
+
+  /// Record a constant [from, to) too big for 64 bits. It is still
+  /// emitted, without a value in the constant pool.
+  void check_range(const char* from, const char* to) {
+    std::uint64_t value;
+    if (number::parse_unsigned(from, to, value) !=
+        number::ParseStatus::Overflow) {
+      return;
+    }
+    const auto length = static_cast<std::uint64_t>(to - from);
+    Diagnostic diagnostic{DiagnosticCode::NumberOverflow,
+                          {},
+                          0,
+                          static_cast<std::uint64_t>(from - m_begin),
+                          length,
+                          length,
+                          1};
+    if (m_chunk != nullptr) {
+      m_chunk->diagnostics.report(diagnostic);
+    } else {
+      m_data.diagnostics.report(diagnostic);
+    }
+  }
+
+  /// Emit the text [from, to) matched by a rule, accepted in dfa_state
+  void token(const TokenRule& rule,
+             const LexerDfa::State& dfa_state,
+             const char* from,
+             const char* to) {
+    if (dfa_state.utf8) {
+      validate(from, to);
+    }
+    if (rule.flags & RuleSkip) {
+      return;
+    }
+    if (rule.kind == TokenKind::Constant &&
+        static_cast<std::size_t>(to - from) >= number::safe_digits) {
+      check_range(from, to);
+    }
+    // reserved words are matched case-insensitively and keep their
+    // canonical spelling
+    if (rule.flags & RuleReserved) {
+      if (auto reserved = find_predefined(from, static_cast<std::size_t>(
+                                                    to - from))) {
+        m_input_buffer.assign(reserved->lexem, reserved->size);
+        emit(m_input_buffer, TokenKind::Predefined, reserved->code);
+        return;
+      }
+    }
+    m_input_buffer.assign(from, to);
+    emit(m_input_buffer, rule.kind, rule.code);
+  }
+
+  // codes every run starts with, shared with the data of past runs
+  std::shared_ptr<const PropertyContainer> m_predefined;
   LexemData m_data;
-  int m_row_start = 0;
-  int m_column_start = 0;
-  int m_row = 0;
-  int m_column = 0;
-  int m_identifier_count = 1000;
-  int m_num_constant_count = 500;
+  std::shared_ptr<const LexerDfa> m_dfa;
+  scan::Kernels m_scan;
+  std::size_t m_offset_start = 0;
+  // next index of each kind
+  std::uint32_t m_identifier_count = 0;
+  std::uint32_t m_num_constant_count = 0;
   //custom 
-  int m_email_count = 2000;
-  std::ifstream& m_file;
-};  // namespace translator
+  std::uint32_t m_email_count = 0;
+  // codes shared with other lexers, if set
+  std::shared_ptr<InternTable> m_intern;
+  const char* m_begin;
+  const char* m_cursor = nullptr;
+  const char* m_end;
+  bool m_eof = false;
+  // line count up to m_line_pos for locate(): rows before it and the
+  // column of the char before it
+  const char* m_line_pos = nullptr;
+  std::int64_t m_line_row = 0;
+  std::int64_t m_line_column = 0;
+  // automaton registers kept between next_token calls
+  std::string m_input_buffer;
+  char m_input_char = -1;
+  LexemToken* m_token = nullptr;
+  bool m_emitted = false;
+  // chunk mode for parallel lexing
+  LexerChunk* m_chunk = nullptr;
+  bool m_chunk_last = true;
+  std::ostream* m_error_output = &std::cout;
+  DiagnosticLimits m_diagnostic_limits;
+  DiagnosticRenderer m_diagnostic_renderer = render_diagnostic_text;
+
+  friend class IncrementalLexer;
+  friend class ParallelLexer;
+  friend class StreamLexer;
+};
 
 }  // namespace translator
\ No newline at end of file
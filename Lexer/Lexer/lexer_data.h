@@ -1,41 +1,390 @@
 /* Basic declarations */
 #pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
+#include "lexer_diagnostics.h"
+#include "lexer_lines.h"
+#include "lexer_number.h"
 #include "lexer_property_container.h"
+#include "lexer_token_code.h"
+#include "print_helpers.h"
 
 namespace translator {
 
 // Describes a token
 struct LexemToken {
   LexemToken() : symbol(-1), name(""), row(-1), column(-1) {}
-  LexemToken(const int _symbol,
+  LexemToken(const TokenCode _symbol,
              const std::string& _name,
-             const int _row,
-             const int _column)
+             const std::int64_t _row,
+             const std::int64_t _column)
       : symbol(_symbol), name(_name), row(_row), column(_column) {}
-  int symbol;
+  TokenCode symbol;
   std::string name;
-  int row;
-  int column;
+  std::int64_t row;
+  std::int64_t column;
 };
 
-// Holder for lexem array and property map
+// Read-only view of a token inside a TokenStore
+struct LexemTokenRef {
+  TokenCode symbol;
+  const std::string& name;
+  std::int64_t row;
+  std::int64_t column;
+
+  operator LexemToken() const { return LexemToken(symbol, name, row, column); }
+};
+
+/// Interned strings. Every distinct string is stored once and gets a
+/// dense id.
+class StringPool {
+ public:
+  StringPool() = default;
+  // the index holds views into m_strings, so copies rebuild it
+  StringPool(const StringPool& rhs) : m_strings(rhs.m_strings) { reindex(); }
+  StringPool& operator=(const StringPool& rhs) {
+    if (this != &rhs) {
+      m_strings = rhs.m_strings;
+      reindex();
+    }
+    return *this;
+  }
+  // deque elements don't move when the deque itself is moved
+  StringPool(StringPool&&) = default;
+  StringPool& operator=(StringPool&&) = default;
+
+  /// Id of s, adding it if it's new
+  std::uint32_t intern(std::string_view s) {
+    auto found = m_index.find(s);
+    if (found != m_index.end()) {
+      return found->second;
+    }
+    auto id = static_cast<std::uint32_t>(m_strings.size());
+    m_strings.emplace_back(s);
+    m_index.emplace(m_strings.back(), id);
+    return id;
+  }
+
+  const std::string& operator[](std::uint32_t id) const {
+    return m_strings[id];
+  }
+  std::size_t size() const { return m_strings.size(); }
+
+  void clear() {
+    m_index.clear();
+    m_strings.clear();
+  }
+
+ private:
+  void reindex() {
+    m_index.clear();
+    for (std::size_t i = 0; i < m_strings.size(); ++i) {
+      m_index.emplace(m_strings[i], static_cast<std::uint32_t>(i));
+    }
+  }
+
+  std::deque<std::string> m_strings;
+  std::unordered_map<std::string_view, std::uint32_t> m_index;
+};
+
+/// Token array stored as parallel arrays of codes, name ids and positions.
+/// Names live once in an interned pool instead of once per token.
+/// Positions are byte offsets into the source once a line index is set,
+/// and rows and columns are looked up in it on access. Without one, e.g.
+/// for tokens read back from a lexer output, explicit rows and columns
+/// are stored instead.
+class TokenStore {
+ public:
+  class const_iterator {
+   public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = LexemToken;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = LexemTokenRef;
+
+    const_iterator(const TokenStore* store, std::size_t pos)
+        : m_store(store), m_pos(pos) {}
+    LexemTokenRef operator*() const { return (*m_store)[m_pos]; }
+    const_iterator& operator++() {
+      ++m_pos;
+      return *this;
+    }
+    const_iterator operator++(int) {
+      auto x = *this;
+      ++m_pos;
+      return x;
+    }
+    const_iterator& operator--() {
+      --m_pos;
+      return *this;
+    }
+    const_iterator& operator+=(difference_type n) {
+      m_pos += n;
+      return *this;
+    }
+    const_iterator operator+(difference_type n) const {
+      return const_iterator(m_store, m_pos + n);
+    }
+    difference_type operator-(const const_iterator& rhs) const {
+      return static_cast<difference_type>(m_pos) -
+             static_cast<difference_type>(rhs.m_pos);
+    }
+    LexemTokenRef operator[](difference_type n) const { return *(*this + n); }
+    bool operator==(const const_iterator& rhs) const {
+      return m_pos == rhs.m_pos;
+    }
+    bool operator!=(const const_iterator& rhs) const {
+      return m_pos != rhs.m_pos;
+    }
+    bool operator<(const const_iterator& rhs) const {
+      return m_pos < rhs.m_pos;
+    }
+
+   private:
+    const TokenStore* m_store;
+    std::size_t m_pos;
+  };
+
+  /// Add a token with an explicit position
+  void emplace_back(const TokenCode symbol,
+                    std::string_view name,
+                    const std::int64_t row,
+                    const std::int64_t column) {
+    m_symbols.push_back(symbol);
+    m_names.push_back(m_pool.intern(name));
+    m_rows.push_back(row);
+    m_columns.push_back(column);
+  }
+  void push_back(const LexemToken& token) {
+    emplace_back(token.symbol, token.name, token.row, token.column);
+  }
+  /// Add a token by the id intern() gave its name
+  void emplace_back_id(const TokenCode symbol,
+                       const std::uint32_t name_id,
+                       const std::int64_t row,
+                       const std::int64_t column) {
+    m_symbols.push_back(symbol);
+    m_names.push_back(name_id);
+    m_rows.push_back(row);
+    m_columns.push_back(column);
+  }
+  /// Add a token at a byte offset; the store must have a line index
+  void emplace_back_at(const TokenCode symbol,
+                       std::string_view name,
+                       const std::uint64_t offset) {
+    m_symbols.push_back(symbol);
+    m_names.push_back(m_pool.intern(name));
+    m_offsets.push_back(offset);
+  }
+  /// Intern a name ahead of the tokens using it
+  std::uint32_t intern(std::string_view name) { return m_pool.intern(name); }
+
+  /// Switch an empty store to offset positions resolved by lines
+  void set_lines(std::shared_ptr<const LineIndex> lines) {
+    m_lines = std::move(lines);
+  }
+  const std::shared_ptr<const LineIndex>& lines() const { return m_lines; }
+  bool has_offsets() const { return m_lines != nullptr; }
+
+  void reserve(std::size_t n) {
+    m_symbols.reserve(n);
+    m_names.reserve(n);
+    if (has_offsets()) {
+      m_offsets.reserve(n);
+    } else {
+      m_rows.reserve(n);
+      m_columns.reserve(n);
+    }
+  }
+  void clear() {
+    m_symbols.clear();
+    m_names.clear();
+    m_offsets.clear();
+    m_rows.clear();
+    m_columns.clear();
+    m_lines.reset();
+    m_pool.clear();
+  }
+
+  /// Replace tokens [first, last) with the tokens of another store that
+  /// keeps its positions the same way
+  void splice(std::size_t first, std::size_t last, const TokenStore& other) {
+    std::vector<std::uint32_t> names(other.size());
+    for (std::size_t i = 0; i < other.size(); ++i) {
+      names[i] = m_pool.intern(other.name(i));
+    }
+    replace(m_symbols, first, last, other.m_symbols);
+    replace(m_names, first, last, names);
+    if (has_offsets()) {
+      replace(m_offsets, first, last, other.m_offsets);
+    } else {
+      replace(m_rows, first, last, other.m_rows);
+      replace(m_columns, first, last, other.m_columns);
+    }
+  }
+
+  /// Move tokens [first, last) down by `rows` rows; explicit positions
+  /// only
+  void shift_rows(std::size_t first, std::size_t last, const std::int64_t rows) {
+    for (std::size_t i = first; i < last; ++i) {
+      m_rows[i] += rows;
+    }
+  }
+  /// Move tokens [first, last) right by `columns` columns; explicit
+  /// positions only
+  void shift_columns(std::size_t first,
+                     std::size_t last,
+                     const std::int64_t columns) {
+    for (std::size_t i = first; i < last; ++i) {
+      m_columns[i] += columns;
+    }
+  }
+
+  std::size_t size() const { return m_symbols.size(); }
+  bool empty() const { return m_symbols.empty(); }
+
+  TokenCode symbol(std::size_t i) const { return m_symbols[i]; }
+  const std::string& name(std::size_t i) const { return m_pool[m_names[i]]; }
+  std::uint32_t name_id(std::size_t i) const { return m_names[i]; }
+  /// Byte offset of a token; stores with a line index only
+  std::uint64_t offset(std::size_t i) const { return m_offsets[i]; }
+  LinePosition position(std::size_t i) const {
+    if (has_offsets()) {
+      return m_lines->locate(m_offsets[i]);
+    }
+    return {m_rows[i], m_columns[i]};
+  }
+  std::int64_t row(std::size_t i) const { return position(i).row; }
+  std::int64_t column(std::size_t i) const { return position(i).column; }
+
+  LexemTokenRef operator[](std::size_t i) const {
+    LinePosition at = position(i);
+    return {m_symbols[i], name(i), at.row, at.column};
+  }
+
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, size()); }
+
+  /// Distinct token names
+  const StringPool& names() const { return m_pool; }
+
+ private:
+  /// Replace v[first, last) with `with`, moving the tail only if the
+  /// sizes differ
+  template <class T>
+  static void replace(std::vector<T>& v,
+                      std::size_t first,
+                      std::size_t last,
+                      const std::vector<T>& with) {
+    std::size_t common = std::min(last - first, with.size());
+    std::copy(with.begin(), with.begin() + common, v.begin() + first);
+    if (with.size() > common) {
+      v.insert(v.begin() + first + common, with.begin() + common, with.end());
+    } else {
+      v.erase(v.begin() + first + common, v.begin() + last);
+    }
+  }
+
+  std::vector<TokenCode> m_symbols;
+  std::vector<std::uint32_t> m_names;
+  // offset positions, with the index resolving them
+  std::vector<std::uint64_t> m_offsets;
+  std::shared_ptr<const LineIndex> m_lines;
+  // explicit positions
+  std::vector<std::int64_t> m_rows;
+  std::vector<std::int64_t> m_columns;
+  StringPool m_pool;
+};
+
+// Holder for lexem array and property map.
+// Move-only: results are handed over, never duplicated.
 struct LexemData {
   LexemData(const PropertyContainer& default_lexem = PropertyContainer())
       : lexem_codes(default_lexem) {}
+  LexemData(const LexemData&) = delete;
+  LexemData& operator=(const LexemData&) = delete;
+  LexemData(LexemData&&) = default;
+  LexemData& operator=(LexemData&&) = default;
 
-  std::vector<LexemToken> tokens;
+  TokenStore tokens;
   PropertyContainer lexem_codes;
+  // lexer errors met while making the tokens
+  DiagnosticSink diagnostics;
+  // values of the constants in lexem_codes
+  ConstantPool constants;
 
-  void new_token(const std::string& lexem,
-                 const int code,
-                 const int row,
-                 const int column) {
+  /// Add a lexem to the code table unless it's already there
+  void add_lexem(const std::string& lexem, const TokenCode code) {
     if (lexem_codes[lexem] < 0) {
       lexem_codes.set(lexem, code);
     }
+  }
+
+  void new_token(const std::string& lexem,
+                 const TokenCode code,
+                 const std::int64_t row,
+                 const std::int64_t column) {
+    add_lexem(lexem, code);
     tokens.emplace_back(code, lexem, row, column);
   }
+  /// Rebuild the constant pool from the code table, for data read back
+  /// rather than lexed
+  void pool_constants() {
+    constants.clear();
+    lexem_codes.for_each([this](const std::string& lexem, TokenCode code) {
+      if (token_code::is(code, TokenKind::Constant)) {
+        constants.parse(code, lexem);
+      }
+    });
+  }
+
+  /// Add a token at a byte offset of the source tokens.lines() indexes
+  void new_token_at(const std::string& lexem,
+                    const TokenCode code,
+                    const std::uint64_t offset) {
+    add_lexem(lexem, code);
+    tokens.emplace_back_at(code, lexem, offset);
+  }
 };
-}  // namespace translator
\ No newline at end of file
+
+/// Head of the token table print_results writes
+inline void print_lexem_list_header(std::ostream &output) {
+  output.width(7);
+  output << "~~Lexem list\n";
+  fixed_width_print_line({ ":name", ":id", ":row", ":column" }, 15, output);
+}
+
+/// One row of the token table
+inline void print_lexem_row(const std::string &name, TokenCode symbol,
+                            std::int64_t row, std::int64_t column,
+                            std::ostream &output) {
+  fixed_width_print_line({ name, token_code::to_string(symbol),
+    std::to_string(row), std::to_string(column) },
+    15, output);
+}
+
+/// The code table that ends print_results
+inline void print_lexem_table(const PropertyContainer &lexem_codes,
+                              std::ostream &output) {
+  output << "~~Lexem table\n";
+  lexem_codes.print(output);
+}
+
+/// Print lexer results as the tables the parser reads back
+inline void print_results(const LexemData &results, std::ostream &output = std::cout) {
+  print_lexem_list_header(output);
+  for (const auto& x : results.tokens) {
+    print_lexem_row(x.name, x.symbol, x.row, x.column, output);
+  }
+  print_lexem_table(results.lexem_codes, output);
+}
+}  // namespace translator
@@ -0,0 +1,211 @@
+/* Lexer diagnostics */
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string_view>
+#include <vector>
+#include "lexer_lines.h"
+
+namespace translator {
+
+enum class DiagnosticCode : unsigned char {
+  // a char no token can start or go on with
+  UnknownIdentifier,
+  // the source ended inside a token or a comment
+  UnexpectedEof,
+  // a byte that isn't part of a valid UTF-8 char
+  InvalidUtf8,
+  // an unsigned integer constant too big for 64 bits
+  NumberOverflow
+};
+
+/// One lexer error, or a run of adjacent ones of the same code
+struct Diagnostic {
+  DiagnosticCode code;
+  // the char that failed the token, up to 4 bytes of UTF-8 of which
+  // input_size are used; -1 at the end of the source
+  char input[4];
+  std::uint8_t input_size;
+  // span of the failed token in the source; its first `prefix` bytes
+  // were read as the token before `input` failed it
+  std::uint64_t offset;
+  std::uint64_t length;
+  std::uint64_t prefix;
+  // errors merged into this one
+  std::uint64_t count;
+};
+
+/// Writes one diagnostic. at is the position of its first byte, token the
+/// prefix of its span.
+using DiagnosticRenderer = void (*)(std::ostream& output,
+                                    const Diagnostic& diagnostic,
+                                    LinePosition at,
+                                    std::string_view token);
+
+/// The lexer's traditional message
+inline void render_diagnostic_text(std::ostream& output,
+                                   const Diagnostic& diagnostic,
+                                   LinePosition at,
+                                   std::string_view token) {
+  output << "Lexer error:";
+  if (diagnostic.code == DiagnosticCode::UnexpectedEof) {
+    output << "Unexpected end of file. \n";
+  } else if (diagnostic.code == DiagnosticCode::InvalidUtf8) {
+    output << "Invalid UTF-8. \n";
+  } else if (diagnostic.code == DiagnosticCode::NumberOverflow) {
+    output << "Number out of range. \n";
+  } else {
+    output << "Unknown identifier. \n";
+  }
+  if (diagnostic.code == DiagnosticCode::InvalidUtf8) {
+    // the byte itself would make the output invalid too
+    const char* digits = "0123456789ABCDEF";
+    const auto byte = static_cast<unsigned char>(diagnostic.input[0]);
+    output << "\\x" << digits[byte >> 4] << digits[byte & 0xF];
+  } else {
+    output.write(diagnostic.input, diagnostic.input_size);
+  }
+  output << "(" << token << ")"
+         << " at "
+         << "[" << at.row << ", " << at.column << "]";
+  if (diagnostic.count > 1) {
+    output << ", " << diagnostic.count << " errors in a row";
+  }
+  output << '\n';
+}
+
+/// One tab-separated line: row, column, code, offset, length, count
+inline void render_diagnostic_line(std::ostream& output,
+                                   const Diagnostic& diagnostic,
+                                   LinePosition at,
+                                   std::string_view) {
+  output << at.row << '\t' << at.column << '\t'
+         << (diagnostic.code == DiagnosticCode::UnexpectedEof ? "eof"
+             : diagnostic.code == DiagnosticCode::InvalidUtf8 ? "utf8"
+             : diagnostic.code == DiagnosticCode::NumberOverflow
+                 ? "overflow"
+                 : "unknown")
+         << '\t' << diagnostic.offset << '\t' << diagnostic.length << '\t'
+         << diagnostic.count << '\n';
+}
+
+/// How much a DiagnosticSink keeps
+struct DiagnosticLimits {
+  // diagnostics kept; errors past them are only counted
+  std::size_t max_kept = 1000;
+  // merge an error into the previous diagnostic when their spans touch
+  // and their codes match
+  bool coalesce = true;
+};
+
+/// Collects lexer errors while lexing, so that nothing is printed from
+/// the hot loop. Garbage input makes runs of adjacent errors, which are
+/// merged, and the number of diagnostics kept is capped.
+class DiagnosticSink {
+ public:
+  explicit DiagnosticSink(const DiagnosticLimits& limits = DiagnosticLimits())
+      : m_limits(limits) {}
+
+  void set_limits(const DiagnosticLimits& limits) { m_limits = limits; }
+  const DiagnosticLimits& limits() const { return m_limits; }
+
+  void report(const Diagnostic& diagnostic) {
+    m_total += diagnostic.count;
+    if (m_limits.coalesce && m_diagnostics.size() > m_sealed) {
+      Diagnostic& last = m_diagnostics.back();
+      if (last.code == diagnostic.code &&
+          last.offset + last.length == diagnostic.offset) {
+        last.length += diagnostic.length;
+        last.count += diagnostic.count;
+        return;
+      }
+    }
+    if (m_diagnostics.size() >= m_limits.max_kept) {
+      m_dropped += diagnostic.count;
+      return;
+    }
+    m_diagnostics.push_back(diagnostic);
+  }
+
+  /// Count errors dropped by another sink, e.g. a chunk's
+  void add_dropped(const std::uint64_t count) {
+    m_total += count;
+    m_dropped += count;
+  }
+
+  /// Print the diagnostics reported since the last flush, and once
+  /// `finished`, how many were dropped. Positions and token text are
+  /// taken from the source they were reported on; locate maps an offset
+  /// to a position. Later reports never merge into flushed diagnostics.
+  template <class Locate>
+  void flush(std::ostream& output,
+             const char* source,
+             Locate&& locate,
+             const bool finished) {
+    flush_some(
+        output,
+        [source](const Diagnostic& x) {
+          return std::string_view(source + x.offset,
+                                  static_cast<std::size_t>(x.prefix));
+        },
+        locate, 0);
+    if (finished) {
+      flush_dropped(output);
+    }
+  }
+
+  /// Print the diagnostics reported since the last flush but the last
+  /// `keep` ones, which later reports may still merge into. For sources
+  /// not kept whole: text gives the span prefix of a diagnostic.
+  template <class Text, class Locate>
+  void flush_some(std::ostream& output,
+                  Text&& text,
+                  Locate&& locate,
+                  const std::size_t keep) {
+    const std::size_t end =
+        m_diagnostics.size() - std::min(keep, m_diagnostics.size() - m_sealed);
+    for (std::size_t i = m_sealed; i < end; ++i) {
+      const Diagnostic& x = m_diagnostics[i];
+      m_renderer(output, x, locate(x.offset), text(x));
+    }
+    m_sealed = end;
+  }
+
+  /// Print how many errors were dropped since the last time
+  void flush_dropped(std::ostream& output) {
+    if (m_dropped > m_flushed_dropped) {
+      output << "Lexer errors not shown: " << m_dropped - m_flushed_dropped
+             << '\n';
+      m_flushed_dropped = m_dropped;
+    }
+  }
+
+  void set_renderer(DiagnosticRenderer renderer) { m_renderer = renderer; }
+
+  const std::vector<Diagnostic>& diagnostics() const { return m_diagnostics; }
+  /// Errors reported, merged and dropped ones included
+  std::uint64_t total() const { return m_total; }
+  /// Errors past the cap
+  std::uint64_t dropped() const { return m_dropped; }
+
+  void clear() {
+    m_diagnostics.clear();
+    m_total = 0;
+    m_dropped = 0;
+    m_sealed = 0;
+    m_flushed_dropped = 0;
+  }
+
+ private:
+  DiagnosticLimits m_limits;
+  DiagnosticRenderer m_renderer = render_diagnostic_text;
+  std::vector<Diagnostic> m_diagnostics;
+  std::uint64_t m_total = 0;
+  std::uint64_t m_dropped = 0;
+  // diagnostics before this one were flushed
+  std::size_t m_sealed = 0;
+  std::uint64_t m_flushed_dropped = 0;
+};
+}  // namespace translator
@@ -0,0 +1,140 @@
+/* Tokens of a LexerAutomaton as a C++20 coroutine generator */
+#pragma once
+// The generator needs C++20 coroutines; older builds keep next_token()
+// and the iterator of LexerAutomaton, and TRANSLATOR_COROUTINES stays
+// undefined.
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define TRANSLATOR_COROUTINES 1
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <utility>
+#include "lexer_automaton.h"
+#include "lexer_data.h"
+
+namespace translator {
+
+/// Lazy sequence of values made by a coroutine that co_yields them one
+/// at a time. The coroutine runs only while a value is asked for and
+/// suspends after each one; its frame is the only allocation.
+/// A yielded value lives in the coroutine until it is resumed again.
+template <class T>
+class Generator {
+ public:
+  struct promise_type {
+    T* value = nullptr;
+    std::exception_ptr error;
+
+    Generator get_return_object() {
+      return Generator(
+          std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    std::suspend_always yield_value(T& x) noexcept {
+      value = &x;
+      return {};
+    }
+    void return_void() noexcept {}
+    void unhandled_exception() { error = std::current_exception(); }
+  };
+
+  Generator(Generator&& rhs) noexcept
+      : m_handle(std::exchange(rhs.m_handle, nullptr)) {}
+  Generator& operator=(Generator&& rhs) noexcept {
+    if (this != &rhs) {
+      destroy();
+      m_handle = std::exchange(rhs.m_handle, nullptr);
+    }
+    return *this;
+  }
+  Generator(const Generator&) = delete;
+  Generator& operator=(const Generator&) = delete;
+  ~Generator() { destroy(); }
+
+  /// Resume up to the next value and swap it into x, so buffers such as
+  /// token names go back and forth instead of being copied.
+  /// Returns false once the coroutine has returned.
+  bool next(T& x) {
+    if (!advance()) {
+      return false;
+    }
+    using std::swap;
+    swap(x, *m_handle.promise().value);
+    return true;
+  }
+
+  /// Input iterator; the values are read in place
+  class iterator {
+   public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T*;
+    using reference = const T&;
+
+    iterator() = default;
+    explicit iterator(Generator* generator) : m_generator(generator) {
+      ++*this;
+    }
+    reference operator*() const { return *m_generator->value(); }
+    pointer operator->() const { return m_generator->value(); }
+    iterator& operator++() {
+      if (!m_generator->advance()) {
+        m_generator = nullptr;
+      }
+      return *this;
+    }
+    bool operator==(const iterator& rhs) const {
+      return m_generator == rhs.m_generator;
+    }
+    bool operator!=(const iterator& rhs) const { return !(*this == rhs); }
+
+   private:
+    Generator* m_generator = nullptr;
+  };
+
+  iterator begin() { return iterator(this); }
+  iterator end() { return iterator(); }
+
+ private:
+  explicit Generator(std::coroutine_handle<promise_type> handle)
+      : m_handle(handle) {}
+
+  /// Resume the coroutine; false once it is done
+  bool advance() {
+    if (m_handle == nullptr || m_handle.done()) {
+      return false;
+    }
+    m_handle.resume();
+    if (m_handle.promise().error) {
+      std::rethrow_exception(m_handle.promise().error);
+    }
+    return !m_handle.done();
+  }
+  const T* value() const { return m_handle.promise().value; }
+
+  void destroy() {
+    if (m_handle != nullptr) {
+      m_handle.destroy();
+    }
+  }
+
+  std::coroutine_handle<promise_type> m_handle;
+};
+
+using TokenGenerator = Generator<LexemToken>;
+
+/// Tokens of the automaton from its read position on, lexed one per
+/// resume. Like next_token(), they aren't kept in the automaton's data
+/// and errors are printed as they are met. The automaton must outlive
+/// the generator.
+inline TokenGenerator lex_tokens(LexerAutomaton& automaton) {
+  LexemToken token;
+  while (automaton.next_token(token)) {
+    co_yield token;
+  }
+}
+}  // namespace translator
+#endif
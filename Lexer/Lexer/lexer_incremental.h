@@ -0,0 +1,228 @@
+/* Incremental re-lexing of an edited source */
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "lexer_automaton.h"
+#include "lexer_data.h"
+#include "predefined_lexem.h"
+
+namespace translator {
+
+/// An edit of a source: `removed` bytes at `offset` were replaced with
+/// `inserted` bytes
+struct SourceEdit {
+  std::size_t offset;
+  std::size_t removed;
+  std::size_t inserted;
+};
+
+/// Tokens changed by an edit: `removed` tokens at `first` were replaced
+/// with `inserted` new ones. Tokens after them were only moved.
+struct TokenEdit {
+  std::size_t first;
+  std::size_t removed;
+  std::size_t inserted;
+};
+
+/// Keeps the tokens of a source up to date while it's being edited.
+/// Lexing from a token start depends on nothing but the text after it,
+/// so an edit is re-lexed from the last token starting before it, up to
+/// the first new token past the edit that lands on the shifted start of
+/// an old one. Old tokens from there on are kept and only moved.
+/// Moving them is deferred: the tail past the last edit carries a pending
+/// offset and row shift, which is applied only between two consecutive
+/// edits or when data() is asked for. Local edits therefore cost the
+/// same in a small and a huge source, unless they change the number of
+/// tokens, which moves the token arrays.
+/// Names already in the code table keep their codes and new names get
+/// the next free ones, so codes are stable across edits but may differ
+/// from a full run. Names that disappear stay in the table.
+class IncrementalLexer {
+ public:
+  IncrementalLexer(const PropertyContainer& predefined_lexem =
+                       translator::predefined_lexem())
+      : m_automaton(nullptr, nullptr, predefined_lexem) {}
+
+  /// Stream lexer errors are printed to, std::cout by default
+  void set_error_output(std::ostream& output) {
+    m_automaton.set_error_output(output);
+  }
+  void set_diagnostic_limits(const DiagnosticLimits& limits) {
+    m_automaton.set_diagnostic_limits(limits);
+  }
+  void set_diagnostic_renderer(DiagnosticRenderer renderer) {
+    m_automaton.set_diagnostic_renderer(renderer);
+  }
+  /// Codes shared with other lexers, see LexerAutomaton::set_intern_table
+  void set_intern_table(std::shared_ptr<InternTable> table) {
+    m_automaton.set_intern_table(std::move(table));
+  }
+
+  /// Lex a whole source. The range is only read during the call.
+  const LexemData& run(const char* begin, const char* end) {
+    LexemData& data = m_automaton.m_data;
+    m_offsets.clear();
+    m_pending = 0;
+    m_pending_offset = 0;
+    m_pending_rows = 0;
+    m_automaton.reset(begin, end);
+    LexemToken token;
+    while (m_automaton.next_token(token)) {
+      data.tokens.push_back(token);
+      m_offsets.push_back(m_automaton.token_offset());
+    }
+    return data;
+  }
+
+  /// Update the tokens after an edit. [begin, end) is the whole source
+  /// with the edit already applied.
+  TokenEdit edit(const char* begin, const char* end, const SourceEdit& change) {
+    TokenStore& tokens = m_automaton.m_data.tokens;
+    const std::size_t edit_end = change.offset + change.inserted;
+
+    // restart at the last token starting before the edit: everything
+    // read up to its first char is unchanged
+    std::size_t first = 0;
+    std::size_t last = tokens.size();
+    while (first < last) {
+      std::size_t middle = first + (last - first) / 2;
+      if (offset(middle) < change.offset) {
+        first = middle + 1;
+      } else {
+        last = middle;
+      }
+    }
+    if (first > 0) {
+      --first;
+      m_automaton.resume(begin, end, begin + offset(first), row(first),
+                         tokens.column(first) - 1);
+    } else {
+      m_automaton.resume(begin, end, begin, 0, 0);
+    }
+    settle(first);
+
+    // lex until a new token starts where an old one did
+    TokenStore fresh;
+    std::vector<std::size_t> fresh_offsets;
+    std::size_t old = first;
+    std::size_t resync = tokens.size();
+    LexemToken token;
+    while (m_automaton.next_token(token)) {
+      const std::size_t at = m_automaton.token_offset();
+      if (at >= edit_end) {
+        const std::size_t old_at = at - change.inserted + change.removed;
+        while (old < tokens.size() && offset(old) < old_at) {
+          ++old;
+        }
+        if (old < tokens.size() && offset(old) == old_at) {
+          resync = old;
+          break;
+        }
+      }
+      fresh.push_back(token);
+      fresh_offsets.push_back(at);
+    }
+
+    // the kept tail moves by the difference in the resync token position;
+    // columns only change up to the end of its line
+    std::int64_t rows = 0;
+    std::int64_t columns = 0;
+    std::size_t same_line = resync;
+    if (resync < tokens.size()) {
+      rows = token.row - row(resync);
+      columns = token.column - tokens.column(resync);
+      const char* line_end = std::find_if(
+          begin + m_automaton.token_offset(), end,
+          [](char c) { return c == '\n' || c == '\r'; });
+      const std::size_t line_end_offset =
+          static_cast<std::size_t>(line_end - begin) - change.inserted +
+          change.removed;
+      while (same_line < tokens.size() && offset(same_line) < line_end_offset) {
+        ++same_line;
+      }
+    }
+
+    TokenEdit result{first, resync - first, fresh.size()};
+    tokens.splice(first, resync, fresh);
+    std::size_t common = std::min(resync - first, fresh_offsets.size());
+    std::copy(fresh_offsets.begin(), fresh_offsets.begin() + common,
+              m_offsets.begin() + first);
+    if (fresh_offsets.size() > common) {
+      m_offsets.insert(m_offsets.begin() + first + common,
+                       fresh_offsets.begin() + common, fresh_offsets.end());
+    } else {
+      m_offsets.erase(m_offsets.begin() + first + common,
+                      m_offsets.begin() + resync);
+    }
+    // the new tokens are exact; the tail past them keeps its pending
+    // shift plus this edit's
+    const std::size_t tail = first + fresh.size();
+    m_pending = tail;
+    m_pending_offset += change.inserted - change.removed;
+    m_pending_rows += rows;
+    tokens.shift_columns(tail, tail + (same_line - resync), columns);
+    return result;
+  }
+
+  /// All tokens with their positions up to date
+  const LexemData& data() {
+    settle(m_offsets.size());
+    m_pending_offset = 0;
+    m_pending_rows = 0;
+    return m_automaton.m_data;
+  }
+
+  std::size_t size() const { return m_offsets.size(); }
+
+  /// Offset of a token from the start of the source
+  std::size_t offset(std::size_t i) const {
+    return i < m_pending ? m_offsets[i] : m_offsets[i] + m_pending_offset;
+  }
+  /// Row of a token
+  std::int64_t row(std::size_t i) const {
+    const TokenStore& tokens = m_automaton.m_data.tokens;
+    return i < m_pending ? tokens.row(i) : tokens.row(i) + m_pending_rows;
+  }
+  /// A token with its position up to date
+  LexemToken token(std::size_t i) const {
+    const TokenStore& tokens = m_automaton.m_data.tokens;
+    return LexemToken(tokens.symbol(i), tokens.name(i), row(i),
+                      tokens.column(i));
+  }
+
+ private:
+  /// Move the start of the pending shift to token `to`, applying or
+  /// taking back the shift on the tokens in between
+  void settle(std::size_t to) {
+    TokenStore& tokens = m_automaton.m_data.tokens;
+    if (m_pending_offset != 0 || m_pending_rows != 0) {
+      if (m_pending < to) {
+        for (std::size_t i = m_pending; i < to; ++i) {
+          m_offsets[i] += m_pending_offset;
+        }
+        tokens.shift_rows(m_pending, to, m_pending_rows);
+      } else {
+        for (std::size_t i = to; i < m_pending; ++i) {
+          m_offsets[i] -= m_pending_offset;
+        }
+        tokens.shift_rows(to, m_pending, -m_pending_rows);
+      }
+    }
+    m_pending = to;
+  }
+
+  LexerAutomaton m_automaton;
+  // start offset of every token, ascending once the pending shift is
+  // applied
+  std::vector<std::size_t> m_offsets;
+  // tokens from m_pending on are off by m_pending_offset (modulo 2^N)
+  // and m_pending_rows
+  std::size_t m_pending = 0;
+  std::size_t m_pending_offset = 0;
+  std::int64_t m_pending_rows = 0;
+};
+}  // namespace translator
@@ -0,0 +1,220 @@
+/* Concurrent interning table */
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+#include "lexer_token_code.h"
+
+namespace translator {
+
+/// Names and their codes shared by many lexers, so one name gets one
+/// code across all the sources lexed with the table, whatever thread
+/// lexes them. Codes are numbered per kind as a lone automaton does, in
+/// the order names are first seen.
+/// The table is split into shards by hash, each an open-addressing table
+/// of pointers to entries that never move. Lookups take no lock: they
+/// read the shard's current table and compare entries in place. Inserts
+/// lock their shard only. A full table is copied to one twice as big and
+/// the old one is kept until the InternTable goes, so a lookup that still
+/// reads it stays safe; at worst it misses the name and the insert finds
+/// it under the lock.
+class InternTable {
+ public:
+  /// Shards, a power of 2
+  static constexpr std::size_t shard_count = 64;
+
+  InternTable() = default;
+  InternTable(const InternTable&) = delete;
+  InternTable& operator=(const InternTable&) = delete;
+
+  /// Code of a name, -1 if it hasn't been interned. Takes no lock.
+  TokenCode find(std::string_view name) const {
+    const std::uint64_t h = hash(name);
+    const Entry* entry = lookup(shard(h), h, name);
+    return entry != nullptr ? entry->code : token_code::none;
+  }
+
+  /// Code of a name, giving it the next index of its kind if it is new.
+  /// A name keeps the kind it was first interned with.
+  TokenCode intern(const TokenKind kind, std::string_view name) {
+    const std::uint64_t h = hash(name);
+    Shard& at = shard(h);
+    if (const Entry* entry = lookup(at, h, name)) {
+      return entry->code;
+    }
+    std::lock_guard<std::mutex> guard(at.lock);
+    if (const Entry* entry = lookup(at, h, name)) {
+      return entry->code;
+    }
+    const auto index = m_counts[static_cast<std::size_t>(kind)].fetch_add(
+        1, std::memory_order_relaxed);
+    at.entries.push_back(
+        Entry{h, token_code::make(kind, index), store(at, name),
+              static_cast<std::uint32_t>(name.size())});
+    insert(at, &at.entries.back());
+    return at.entries.back().code;
+  }
+
+  /// Names interned so far
+  std::size_t size() const {
+    std::size_t total = 0;
+    for (const Shard& x : m_shards) {
+      total += x.used.load(std::memory_order_relaxed);
+    }
+    return total;
+  }
+
+  /// Names interned so far of a kind
+  std::uint32_t count(const TokenKind kind) const {
+    return m_counts[static_cast<std::size_t>(kind)].load(
+        std::memory_order_relaxed);
+  }
+
+  /// Call f(name, code) for every name, shard by shard. Inserts into the
+  /// shard being walked wait.
+  void for_each(
+      const std::function<void(std::string_view, TokenCode)>& f) const {
+    for (const Shard& x : m_shards) {
+      std::lock_guard<std::mutex> guard(x.lock);
+      for (const Entry& entry : x.entries) {
+        f(std::string_view(entry.text, entry.size), entry.code);
+      }
+    }
+  }
+
+ private:
+  /// A name and its code; written once, before it is published
+  struct Entry {
+    std::uint64_t hash;
+    TokenCode code;
+    const char* text;
+    std::uint32_t size;
+  };
+
+  struct Table {
+    explicit Table(const std::size_t size)
+        : mask(size - 1), slots(new std::atomic<const Entry*>[size]) {
+      for (std::size_t i = 0; i < size; ++i) {
+        slots[i].store(nullptr, std::memory_order_relaxed);
+      }
+    }
+    std::size_t mask;
+    std::unique_ptr<std::atomic<const Entry*>[]> slots;
+  };
+
+  /// Kept on its own cache line, so inserts into neighbours don't slow
+  /// its lookups down
+  struct alignas(64) Shard {
+    std::atomic<const Table*> table{nullptr};
+    std::atomic<std::size_t> used{0};
+    mutable std::mutex lock;
+    // every table the shard had, the current one last
+    std::vector<std::unique_ptr<Table>> tables;
+    // entries never move once pushed
+    std::deque<Entry> entries;
+    // name bytes, in blocks that never move either
+    std::vector<std::unique_ptr<char[]>> blocks;
+    std::size_t block_free = 0;
+  };
+
+  static constexpr std::size_t block_size = 1 << 16;
+
+  /// std::hash of the name, mixed over all 64 bits: where size_t is 32
+  /// bits wide the top bits would be 0, and every name in one shard
+  static std::uint64_t hash(std::string_view name) {
+    auto h = static_cast<std::uint64_t>(std::hash<std::string_view>()(name));
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    return h;
+  }
+
+  /// Shards are picked by the top bits, slots by the bottom ones
+  Shard& shard(const std::uint64_t h) { return m_shards[h >> 58]; }
+  const Shard& shard(const std::uint64_t h) const { return m_shards[h >> 58]; }
+
+  static const Entry* lookup(const Shard& at,
+                             const std::uint64_t h,
+                             std::string_view name) {
+    const Table* table = at.table.load(std::memory_order_acquire);
+    if (table == nullptr) {
+      return nullptr;
+    }
+    for (std::size_t i = h & table->mask;; i = (i + 1) & table->mask) {
+      const Entry* entry = table->slots[i].load(std::memory_order_acquire);
+      if (entry == nullptr) {
+        return nullptr;
+      }
+      if (entry->hash == h && entry->size == name.size() &&
+          std::memcmp(entry->text, name.data(), name.size()) == 0) {
+        return entry;
+      }
+    }
+  }
+
+  /// Copy a name into the shard's blocks. Under the shard lock.
+  static const char* store(Shard& at, std::string_view name) {
+    if (name.size() > block_size / 4) {
+      at.blocks.emplace(at.blocks.begin(), new char[name.size()]);
+      std::memcpy(at.blocks.front().get(), name.data(), name.size());
+      return at.blocks.front().get();
+    }
+    if (at.blocks.empty() || at.block_free < name.size()) {
+      at.blocks.emplace_back(new char[block_size]);
+      at.block_free = block_size;
+    }
+    char* text = at.blocks.back().get() + (block_size - at.block_free);
+    std::memcpy(text, name.data(), name.size());
+    at.block_free -= name.size();
+    return text;
+  }
+
+  /// Publish a new entry. Under the shard lock.
+  static void insert(Shard& at, const Entry* entry) {
+    const std::size_t used = at.used.load(std::memory_order_relaxed) + 1;
+    const Table* table = at.table.load(std::memory_order_relaxed);
+    if (table == nullptr || used * 2 > table->mask + 1) {
+      table = grow(at, table);
+    }
+    place(*table, entry, std::memory_order_release);
+    at.used.store(used, std::memory_order_relaxed);
+  }
+
+  static void place(const Table& table,
+                    const Entry* entry,
+                    const std::memory_order order) {
+    std::size_t i = entry->hash & table.mask;
+    while (table.slots[i].load(std::memory_order_relaxed) != nullptr) {
+      i = (i + 1) & table.mask;
+    }
+    table.slots[i].store(entry, order);
+  }
+
+  /// Switch to a table twice as big; the old one stays for lookups
+  /// still reading it
+  static const Table* grow(Shard& at, const Table* old) {
+    auto table = std::make_unique<Table>(old != nullptr ? (old->mask + 1) * 2
+                                                        : 64);
+    if (old != nullptr) {
+      for (std::size_t i = 0; i <= old->mask; ++i) {
+        if (auto entry = old->slots[i].load(std::memory_order_relaxed)) {
+          place(*table, entry, std::memory_order_relaxed);
+        }
+      }
+    }
+    at.tables.push_back(std::move(table));
+    at.table.store(at.tables.back().get(), std::memory_order_release);
+    return at.tables.back().get();
+  }
+
+  Shard m_shards[shard_count];
+  std::atomic<std::uint32_t> m_counts[token_code::tag_count] = {};
+};
+}  // namespace translator
@@ -0,0 +1,86 @@
+/* Line index for turning byte offsets into rows and columns */
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "lexer_scan.h"
+
+namespace translator {
+
+/// Row and column of a char, as the lexer reports them
+struct LinePosition {
+  std::int64_t row;
+  std::int64_t column;
+};
+
+/// Line breaks of a source. Tokens keep only their byte offsets; rows and
+/// columns are looked up here when something prints them.
+/// The row of a char is the number of '\n' up to and including it. Its
+/// column counts the chars since the last '\n' or '\r', itself included,
+/// so a line break has column 0 and the first char of a line column 1.
+/// Chars are UTF-8 code points: the continuation bytes of a multibyte
+/// char are indexed too, and left out of columns.
+class LineIndex {
+ public:
+  LineIndex() = default;
+  /// Index of a source range; offsets are taken from begin
+  LineIndex(const char* begin, const char* end) {
+    scan::kernels().line_breaks(begin, end, begin, m_newlines, m_returns,
+                                m_continuations);
+  }
+
+  /// Add the breaks of a range that follows the indexed one and starts
+  /// at offset base
+  void append(const LineIndex& next, const std::uint64_t base) {
+    for (std::uint64_t x : next.m_newlines) {
+      m_newlines.push_back(base + x);
+    }
+    for (std::uint64_t x : next.m_returns) {
+      m_returns.push_back(base + x);
+    }
+    for (std::uint64_t x : next.m_continuations) {
+      m_continuations.push_back(base + x);
+    }
+  }
+
+  /// Number of '\n' in the range
+  std::int64_t rows() const {
+    return static_cast<std::int64_t>(m_newlines.size());
+  }
+
+  /// Row and column of the char at offset
+  LinePosition locate(const std::uint64_t offset) const {
+    auto after_newline =
+        std::upper_bound(m_newlines.begin(), m_newlines.end(), offset);
+    const auto rows =
+        static_cast<std::int64_t>(after_newline - m_newlines.begin());
+    // one past the last line break, 0 if there is none
+    std::uint64_t line_start =
+        rows > 0 ? *(after_newline - 1) + 1 : std::uint64_t(0);
+    if (!m_returns.empty()) {
+      auto after_return =
+          std::upper_bound(m_returns.begin(), m_returns.end(), offset);
+      if (after_return != m_returns.begin()) {
+        line_start = std::max(line_start, *(after_return - 1) + 1);
+      }
+    }
+    std::uint64_t column = offset + 1 - line_start;
+    if (!m_continuations.empty()) {
+      column -= static_cast<std::uint64_t>(
+          std::upper_bound(m_continuations.begin(), m_continuations.end(),
+                           offset) -
+          std::lower_bound(m_continuations.begin(), m_continuations.end(),
+                           line_start));
+    }
+    return {rows, static_cast<std::int64_t>(column)};
+  }
+
+ private:
+  // offsets of every '\n', every '\r' and every UTF-8 continuation
+  // byte, ascending; the last are empty for ASCII sources
+  std::vector<std::uint64_t> m_newlines;
+  std::vector<std::uint64_t> m_returns;
+  std::vector<std::uint64_t> m_continuations;
+};
+}  // namespace translator
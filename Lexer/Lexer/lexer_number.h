@@ -0,0 +1,136 @@
+/* Unsigned integer constants: digit conversion and the value pool */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "lexer_token_code.h"
+
+namespace translator {
+namespace number {
+
+/// What parse_unsigned made of a text
+enum class ParseStatus { Value, Overflow, NotDigits };
+
+/// Eight bytes at p, the first in the lowest byte
+inline std::uint64_t load_eight(const char* p) {
+  std::uint64_t word;
+  std::memcpy(&word, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  word = __builtin_bswap64(word);
+#endif
+  return word;
+}
+
+/// All eight bytes of a word are '0'..'9'
+inline bool eight_digits(const std::uint64_t word) {
+  // a byte below '0' borrows into its high bit, one above '9' carries
+  return (((word + 0x4646464646464646ull) | (word - 0x3030303030303030ull)) &
+          0x8080808080808080ull) == 0;
+}
+
+/// Value of eight digits loaded with load_eight. Neighbouring digits are
+/// joined into pairs, the pairs into fours and the fours into the value,
+/// each step one multiply over the whole word.
+inline std::uint32_t eight_digits_value(std::uint64_t word) {
+  word -= 0x3030303030303030ull;
+  word = (word * 10 + (word >> 8)) & 0x00FF00FF00FF00FFull;
+  word = (word * 100 + (word >> 16)) & 0x0000FFFF0000FFFFull;
+  word = (word * 10000 + (word >> 32)) & 0x00000000FFFFFFFFull;
+  return static_cast<std::uint32_t>(word);
+}
+
+/// Convert decimal digits [p, end) to a 64-bit value, eight at a time.
+/// value is left unspecified unless the result is Value.
+inline ParseStatus parse_unsigned(const char* p,
+                                  const char* end,
+                                  std::uint64_t& value) {
+  if (p == end) {
+    return ParseStatus::NotDigits;
+  }
+  const std::uint64_t max = ~std::uint64_t(0);
+  bool overflow = false;
+  value = 0;
+  for (; end - p >= 8; p += 8) {
+    const std::uint64_t word = load_eight(p);
+    if (!eight_digits(word)) {
+      return ParseStatus::NotDigits;
+    }
+    const std::uint32_t part = eight_digits_value(word);
+    if (value > (max - part) / 100000000u) {
+      overflow = true;
+    }
+    value = value * 100000000u + part;
+  }
+  for (; p != end; ++p) {
+    const auto digit = static_cast<unsigned char>(*p - '0');
+    if (digit > 9) {
+      return ParseStatus::NotDigits;
+    }
+    if (value > (max - digit) / 10) {
+      overflow = true;
+    }
+    value = value * 10 + digit;
+  }
+  return overflow ? ParseStatus::Overflow : ParseStatus::Value;
+}
+
+/// Digit runs shorter than this always fit in 64 bits
+constexpr std::size_t safe_digits = 20;
+}  // namespace number
+
+/// Values of the unsigned integer constants of a source, each kept once
+/// under the index of its constant code, so later stages use them
+/// without parsing the names again. Constants too big for 64 bits have
+/// no value.
+class ConstantPool {
+ public:
+  /// Keep the value of a constant code
+  void set(const TokenCode code, const std::uint64_t value) {
+    const std::uint32_t i = token_code::index(code);
+    if (i >= m_values.size()) {
+      m_values.resize(static_cast<std::size_t>(i) + 1);
+      m_known.resize(static_cast<std::size_t>(i) + 1);
+    }
+    m_values[i] = value;
+    m_known[i] = true;
+  }
+  /// Convert a constant's name and keep its value; false if it doesn't
+  /// fit in 64 bits or isn't decimal digits
+  bool parse(const TokenCode code, const std::string& name) {
+    std::uint64_t value;
+    if (number::parse_unsigned(name.data(), name.data() + name.size(),
+                               value) != number::ParseStatus::Value) {
+      return false;
+    }
+    set(code, value);
+    return true;
+  }
+
+  /// The constant code has a value
+  bool has(const TokenCode code) const {
+    const std::uint32_t i = token_code::index(code);
+    return token_code::is(code, TokenKind::Constant) && i < m_known.size() &&
+           m_known[i];
+  }
+  /// Value of a constant code, 0 if it has none
+  std::uint64_t value(const TokenCode code) const {
+    return has(code) ? m_values[token_code::index(code)] : 0;
+  }
+  std::uint64_t operator[](const TokenCode code) const { return value(code); }
+
+  /// One past the highest index with a value; with codes from a shared
+  /// InternTable, indexes of other sources' constants are left empty
+  std::size_t size() const { return m_values.size(); }
+
+  void clear() {
+    m_values.clear();
+    m_known.clear();
+  }
+
+ private:
+  std::vector<std::uint64_t> m_values;
+  std::vector<bool> m_known;
+};
+}  // namespace translator
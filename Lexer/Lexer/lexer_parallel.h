@@ -0,0 +1,189 @@
+/* Parallel lexing of one source */
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "lexer_automaton.h"
+#include "lexer_data.h"
+
+namespace translator {
+
+/// Lexes one source range on several threads.
+/// The range is split into chunks that end right after a '\n'. At such a
+/// point the sequential automaton is either between tokens or inside a
+/// (* ... *) comment, or whatever rule spans lines, which meets in one
+/// DFA state after a '\n'. So every chunk but the first is lexed twice,
+/// speculatively, from both entry states. Once the real entry state of
+/// each chunk is known the matching results are stitched in order, and
+/// codes are assigned there, so the output equals the sequential one.
+class ParallelLexer {
+ public:
+  /// Chunks smaller than this are not worth a thread
+  static constexpr std::size_t min_chunk_size = 1 << 20;
+
+  ParallelLexer(const char* begin,
+                const char* end,
+                std::shared_ptr<const PropertyContainer> predefined_lexem,
+                unsigned threads = 0,
+                std::shared_ptr<const LexerDfa> rules = nullptr)
+      : m_begin(begin),
+        m_end(end),
+        m_predefined_lexem(std::move(predefined_lexem)),
+        m_rules(rules != nullptr ? std::move(rules)
+                                 : signal_dfa(*m_predefined_lexem)),
+        m_threads(threads != 0 ? threads : std::thread::hardware_concurrency()) {
+    if (m_threads == 0) {
+      m_threads = 1;
+    }
+  }
+
+  /// Stream lexer errors are printed to, std::cout by default
+  void set_error_output(std::ostream& output) { m_error_output = &output; }
+  void set_diagnostic_limits(const DiagnosticLimits& limits) {
+    m_diagnostic_limits = limits;
+  }
+  void set_diagnostic_renderer(DiagnosticRenderer renderer) {
+    m_diagnostic_renderer = renderer;
+  }
+  /// Codes shared with other lexers, see LexerAutomaton::set_intern_table
+  void set_intern_table(std::shared_ptr<InternTable> table) {
+    m_intern = std::move(table);
+  }
+
+  LexemData run() {
+    LexerAutomaton main(m_begin, m_end, m_predefined_lexem, m_rules);
+    main.set_error_output(*m_error_output);
+    main.set_diagnostic_limits(m_diagnostic_limits);
+    main.set_diagnostic_renderer(m_diagnostic_renderer);
+    main.set_intern_table(m_intern);
+    std::vector<const char*> bounds = split();
+    std::size_t count = bounds.size() - 1;
+    if (count < 2) {
+      return main.run();
+    }
+
+    // task 2 * i lexes chunk i from between tokens, 2 * i + 1 from inside
+    // a comment; the first chunk always starts between tokens
+    std::vector<LexerChunk> results(2 * count);
+    std::atomic<std::size_t> next_task(0);
+    auto worker = [&]() {
+      for (std::size_t task = next_task++; task < results.size();
+           task = next_task++) {
+        std::size_t i = task / 2;
+        if (task == 1) {
+          continue;
+        }
+        LexerAutomaton chunk(bounds[i], bounds[i + 1], m_predefined_lexem,
+                             m_rules);
+        chunk.set_diagnostic_limits(m_diagnostic_limits);
+        results[task] = chunk.lex_chunk(task % 2 == 1, i + 1 == count);
+      }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < std::min<std::size_t>(m_threads, results.size());
+         ++i) {
+      pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& x : pool) {
+      x.join();
+    }
+
+    stitch(main, results, bounds);
+    return std::move(main.m_data);
+  }
+
+ private:
+  /// Chunk bounds; every inner bound follows a '\n'
+  std::vector<const char*> split() const {
+    std::vector<const char*> bounds{m_begin};
+    std::size_t size = static_cast<std::size_t>(m_end - m_begin);
+    std::size_t count =
+        std::min<std::size_t>(m_threads, size / min_chunk_size);
+    for (std::size_t i = 1; i < count; ++i) {
+      const char* from = std::max(m_begin + size * i / count, bounds.back());
+      auto newline = static_cast<const char*>(
+          std::memchr(from, '\n', static_cast<std::size_t>(m_end - from)));
+      if (newline == nullptr) {
+        break;
+      }
+      if (newline + 1 != m_end) {
+        bounds.push_back(newline + 1);
+      }
+    }
+    bounds.push_back(m_end);
+    return bounds;
+  }
+
+  /// Pick each chunk's result by its real entry state and append its
+  /// tokens, assigning codes as the sequential automaton would
+  void stitch(LexerAutomaton& main,
+              const std::vector<LexerChunk>& results,
+              const std::vector<const char*>& bounds) const {
+    const std::size_t count = bounds.size() - 1;
+    // the chunk line indexes make up the line index of the source
+    std::vector<const LexerChunk*> picked(count);
+    auto lines = std::make_shared<LineIndex>();
+    bool in_comment = false;
+    for (std::size_t i = 0; i < count; ++i) {
+      picked[i] = &results[2 * i + (in_comment ? 1 : 0)];
+      lines->append(*picked[i]->tokens.lines(),
+                    static_cast<std::uint64_t>(bounds[i] - m_begin));
+      in_comment = picked[i]->in_comment;
+    }
+    LexemData& data = main.m_data;
+    data.tokens.set_lines(lines);
+
+    std::uint64_t offset_start = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+      const LexerChunk& chunk = *picked[i];
+      const auto base = static_cast<std::uint64_t>(bounds[i] - m_begin);
+      const std::vector<Diagnostic>& diagnostics =
+          chunk.diagnostics.diagnostics();
+      for (std::size_t j = 0; j < diagnostics.size(); ++j) {
+        Diagnostic diagnostic = diagnostics[j];
+        const std::uint64_t end =
+            base + diagnostic.offset + diagnostic.length;
+        diagnostic.offset = chunk.unpositioned(j)
+                                ? offset_start
+                                : base + diagnostic.offset;
+        diagnostic.length = end - diagnostic.offset;
+        data.diagnostics.report(diagnostic);
+      }
+      data.diagnostics.add_dropped(chunk.diagnostics.dropped());
+      const TokenStore& tokens = chunk.tokens;
+      for (std::size_t j = 0; j < tokens.size(); ++j) {
+        const std::string& name = tokens.name(j);
+        TokenCode code = main.assign_code(chunk.kinds[j], name, tokens.symbol(j));
+        data.new_token_at(name, code, base + tokens.offset(j));
+      }
+      if (chunk.has_position) {
+        offset_start = base + chunk.offset_start;
+      }
+      if (chunk.halted) {
+        break;
+      }
+    }
+    data.diagnostics.flush(
+        *main.m_error_output, m_begin,
+        [&lines](std::uint64_t offset) { return lines->locate(offset); },
+        true);
+  }
+
+  const char* m_begin;
+  const char* m_end;
+  std::shared_ptr<const PropertyContainer> m_predefined_lexem;
+  std::shared_ptr<const LexerDfa> m_rules;
+  unsigned m_threads;
+  std::ostream* m_error_output = &std::cout;
+  DiagnosticLimits m_diagnostic_limits;
+  DiagnosticRenderer m_diagnostic_renderer = render_diagnostic_text;
+  std::shared_ptr<InternTable> m_intern;
+};
+}  // namespace translator
@@ -1,41 +1,56 @@
 #pragma once
 #include <cctype>
+#include <cstddef>
+#include <cstdint>
 #include <set>
 #include <unordered_map>
 #include <vector>
 #include <iostream>
 #include <algorithm>
+#include <functional>
+#include <memory>
 #include <string>
+#include <string_view>
+#include "lexer_token_code.h"
 #include "print_helpers.h"
 
 namespace translator {
-/// Container for lexems and codes
+/// Container for lexems and codes.
+/// Every lexem is kept once, in a string arena. Codes come in dense bands
+/// (chars, 301+, 401+, then index 0+ of every other token kind), so
+/// code -> lexem is a sorted list of dense vectors, one per band, and
+/// lexem -> code an open-addressing hash table keyed by the arena strings.
 class PropertyContainer {
  public:
   PropertyContainer(const int inc = 0) : m_current_index(inc) {}
   PropertyContainer(std::vector<std::string>& data, const int inc = 0)
       : m_current_index(inc) {
-    build_internal_maps(data, inc);
+    build_internal_maps(data);
     gen_allowed_symbols();
   }
 
   // The map must be one-to-one for PropertyContainer to construct.
-  PropertyContainer(std::unordered_map<std::string, int>& data_map)
-      : m_lexem2code_map(data_map) {
+  PropertyContainer(const std::unordered_map<std::string, int>& data_map)
+      : m_current_index(0) {
     for (auto& x : data_map) {
-      m_code2lexem_map[x.second] = x.first;
+      set(x.first, x.second);
     }
     gen_allowed_symbols();
   }
 
-  PropertyContainer(std::unordered_map<int, std::string>& data_map)
-      : m_code2lexem_map(data_map) {
+  PropertyContainer(const std::unordered_map<int, std::string>& data_map)
+      : m_current_index(0) {
     for (auto& x : data_map) {
-      m_lexem2code_map[x.second] = x.first;
+      set(x.second, x.first);
     }
     gen_allowed_symbols();
   }
 
+  /// Empty container on top of a shared one: lookups fall through to the
+  /// base, new pairs are kept here. The base is never copied or changed.
+  explicit PropertyContainer(std::shared_ptr<const PropertyContainer> base)
+      : m_current_index(0), m_base(std::move(base)) {}
+
   /// Append lexem to container
   /// Lexem code is generated automatically
   void append(const std::string& lexem) {
@@ -45,65 +60,325 @@ class PropertyContainer {
   }
 
   /// Set lexem/code pair
-  void set(const std::string& lexem, int index) {
+  void set(const std::string& lexem, TokenCode index) {
     /*
     //remove previous
     remove(lexem);
     remove(index);
     */
-    m_code2lexem_map[index] = lexem;
-    m_lexem2code_map[lexem] = index;
+    if (m_slots.empty()) {
+      grow();
+    }
+    std::uint32_t entry = m_slots[find_slot(lexem)].entry;
+    if (entry == empty_entry) {
+      entry = static_cast<std::uint32_t>(m_entries.size());
+      m_entries.push_back({static_cast<std::uint32_t>(m_chars.size()),
+                           static_cast<std::uint32_t>(lexem.size()), index,
+                           true});
+      m_chars.append(lexem);
+      insert_slot(lexem, entry);
+    } else {
+      m_entries[entry].code = index;
+    }
+    set_code(index, entry);
   }
 
   /// Remove lexem
   void remove(const std::string& lexem) {
-    if (m_lexem2code_map.count(lexem)) {
-      auto code = m_lexem2code_map[lexem];
-      m_code2lexem_map.erase(code);
-      m_lexem2code_map.erase(lexem);
+    if (m_slots.empty()) {
+      return;
     }
+    std::size_t slot = find_slot(lexem);
+    std::uint32_t entry = m_slots[slot].entry;
+    if (entry == empty_entry) {
+      return;
+    }
+    set_code(m_entries[entry].code, empty_entry);
+    m_entries[entry].alive = false;
+    m_slots[slot].entry = removed_entry;
   }
 
   /// Remove code
-  void remove(const int code) {
-    if (m_code2lexem_map.count(code)) {
-      auto lexem = m_code2lexem_map[code];
-      m_lexem2code_map.erase(lexem);
-      m_code2lexem_map.erase(code);
+  void remove(const TokenCode code) {
+    std::uint32_t entry = code_entry(code);
+    if (entry != empty_entry) {
+      remove(std::string(name(entry)));
+      set_code(code, empty_entry);
     }
   }
 
   /// Used to find lexem by code
-  auto operator[](const int code) const {
-    return m_code2lexem_map.count(code) > 0 ? m_code2lexem_map.at(code)
-                                             : std::string();
+  std::string operator[](const TokenCode code) const {
+    std::uint32_t entry = code_entry(code);
+    if (entry != empty_entry) {
+      return std::string(name(entry));
+    }
+    return m_base ? (*m_base)[code] : std::string();
   }
 
   /// Used to find lexem by value
-  auto operator[](const std::string& lexem) const {
-    return m_lexem2code_map.count(lexem) > 0 ? m_lexem2code_map.at(lexem) : -1;
+  TokenCode operator[](const std::string& lexem) const { return find(lexem); }
+
+  /// Code of a lexem, -1 if there is none
+  TokenCode find(std::string_view lexem) const {
+    if (!m_slots.empty()) {
+      std::uint32_t entry = m_slots[find_slot(lexem)].entry;
+      if (entry != empty_entry) {
+        return m_entries[entry].code;
+      }
+    }
+    return m_base ? m_base->find(lexem) : -1;
   }
 
   /// Determine if symbol is allowed
-  bool isallowed(char c) { return (allowed_symbols.count(c) > 0); }
+  bool isallowed(char c) const {
+    return allowed_symbols.count(c) > 0 || (m_base && m_base->isallowed(c));
+  }
 
-  void print(std::ostream &output = std::cout) {
-    fixed_width_print_line({ ":name", ":id" }, 15, output);
-    std::vector<int> ids;
-    for (auto &x : m_lexem2code_map) {
-      ids.push_back(x.second);
-    }  
-    std::sort(ids.begin(), ids.end());
-    for (auto &id : ids) {
-      fixed_width_print_line({ m_code2lexem_map[id], std::to_string(id)}, 15, output);
+  /// Call f(lexem, code) for every stored pair, base pairs first, each
+  /// container's in the order they were added
+  template <class F>
+  void for_each(F f) const {
+    // this container and its bases, the bottom one last
+    std::vector<const PropertyContainer*> chain;
+    for (auto level = this; level != nullptr; level = level->m_base.get()) {
+      chain.push_back(level);
+    }
+    for (auto level = chain.size(); level-- > 0;) {
+      const PropertyContainer& x = *chain[level];
+      for (std::uint32_t i = 0; i < x.m_entries.size(); ++i) {
+        if (!x.m_entries[i].alive) {
+          continue;
+        }
+        const std::string_view lexem = x.name(i);
+        // skip pairs a container above redefines
+        bool shadowed = false;
+        for (std::size_t above = 0; above < level && !shadowed; ++above) {
+          shadowed = chain[above]->owns(lexem);
+        }
+        if (!shadowed) {
+          f(std::string(lexem), x.m_entries[i].code);
+        }
+      }
     }
   }
 
+  /// Print the pairs ordered by code. The bands are walked in order, so
+  /// nothing has to be sorted.
+  void print(std::ostream &output = std::cout) const {
+    fixed_width_print_line({ ":name", ":id" }, 15, output);
+    print_codes(output);
+  }
+
  private:
+  static constexpr std::uint32_t empty_entry = 0xFFFFFFFF;
+  static constexpr std::uint32_t removed_entry = 0xFFFFFFFE;
+  // codes this close past a band join it instead of starting a new one
+  static constexpr std::int64_t band_gap = 64;
+
+  /// A lexem in the arena and its code
+  struct Entry {
+    std::uint32_t offset;
+    std::uint32_t size;
+    TokenCode code;
+    bool alive;
+  };
+
+  /// Hash table slot; hash keeps most mismatches off the arena
+  struct Slot {
+    std::uint32_t hash;
+    std::uint32_t entry;
+  };
+
+  /// Entries of the codes first, first + 1, ...
+  struct Band {
+    TokenCode first;
+    std::vector<std::uint32_t> entries;
+  };
+
+  std::string_view name(std::uint32_t entry) const {
+    return std::string_view(m_chars.data() + m_entries[entry].offset,
+                            m_entries[entry].size);
+  }
+
+  static std::uint32_t hash(std::string_view lexem) {
+    return static_cast<std::uint32_t>(std::hash<std::string_view>()(lexem));
+  }
+
+  /// Slot of a lexem, or the empty slot ending its probe sequence.
+  /// The table must not be empty.
+  std::size_t find_slot(std::string_view lexem) const {
+    const std::uint32_t h = hash(lexem);
+    const std::size_t mask = m_slots.size() - 1;
+    for (std::size_t i = h & mask;; i = (i + 1) & mask) {
+      const Slot& slot = m_slots[i];
+      if (slot.entry == empty_entry) {
+        return i;
+      }
+      if (slot.hash == h && slot.entry != removed_entry &&
+          name(slot.entry) == lexem) {
+        return i;
+      }
+    }
+  }
+
+  /// The lexem is set on this container itself
+  bool owns(std::string_view lexem) const {
+    return !m_slots.empty() &&
+           m_slots[find_slot(lexem)].entry != empty_entry;
+  }
+
+  /// Add a new lexem to the hash table
+  void insert_slot(std::string_view lexem, std::uint32_t entry) {
+    if ((m_used + 1) * 2 > m_slots.size()) {
+      grow();
+    }
+    const std::uint32_t h = hash(lexem);
+    const std::size_t mask = m_slots.size() - 1;
+    std::size_t i = h & mask;
+    while (m_slots[i].entry != empty_entry) {
+      i = (i + 1) & mask;
+    }
+    m_slots[i] = {h, entry};
+    ++m_used;
+  }
+
+  /// Double the hash table, dropping removed slots
+  void grow() {
+    std::vector<Slot> old(std::max<std::size_t>(m_slots.size() * 2, 16),
+                          Slot{0, empty_entry});
+    old.swap(m_slots);
+    m_used = 0;
+    const std::size_t mask = m_slots.size() - 1;
+    for (const Slot& x : old) {
+      if (x.entry == empty_entry || x.entry == removed_entry) {
+        continue;
+      }
+      std::size_t i = x.hash & mask;
+      while (m_slots[i].entry != empty_entry) {
+        i = (i + 1) & mask;
+      }
+      m_slots[i] = x;
+      ++m_used;
+    }
+  }
+
+  /// Entry a code maps to here, empty_entry if none
+  std::uint32_t code_entry(const TokenCode code) const {
+    auto next = std::upper_bound(
+        m_bands.begin(), m_bands.end(), code,
+        [](TokenCode x, const Band& band) { return x < band.first; });
+    if (next == m_bands.begin()) {
+      return empty_entry;
+    }
+    const Band& band = *(next - 1);
+    const auto index = code - band.first;
+    return index < static_cast<std::int64_t>(band.entries.size())
+               ? band.entries[static_cast<std::size_t>(index)]
+               : empty_entry;
+  }
+
+  /// Map a code to an entry, growing or joining bands as needed
+  void set_code(const TokenCode code, const std::uint32_t entry) {
+    auto next = std::upper_bound(
+        m_bands.begin(), m_bands.end(), code,
+        [](TokenCode x, const Band& band) { return x < band.first; });
+    if (next != m_bands.begin()) {
+      Band& band = *(next - 1);
+      const auto index = code - band.first;
+      const auto size = static_cast<std::int64_t>(band.entries.size());
+      if (index < size + band_gap) {
+        if (index >= size) {
+          band.entries.resize(static_cast<std::size_t>(index) + 1,
+                              empty_entry);
+        }
+        band.entries[static_cast<std::size_t>(index)] = entry;
+        join_next(next - 1);
+        return;
+      }
+    }
+    join_next(m_bands.insert(next, Band{code, {entry}}));
+  }
+
+  /// Merge the bands that follow a band closely into it
+  void join_next(std::vector<Band>::iterator band) {
+    auto next = band + 1;
+    while (next != m_bands.end() &&
+           band->first + static_cast<std::int64_t>(band->entries.size()) +
+                   band_gap >
+               next->first) {
+      band->entries.resize(static_cast<std::size_t>(next->first - band->first),
+                           empty_entry);
+      band->entries.insert(band->entries.end(), next->entries.begin(),
+                           next->entries.end());
+      next = m_bands.erase(next);
+      band = next - 1;
+    }
+  }
+
+  /// Print the pairs of this container and its bases, ordered by code
+  void print_codes(std::ostream& output) const {
+    // codes set here and the ones under them, merged in order
+    std::vector<const PropertyContainer*> chain;
+    for (auto level = this; level != nullptr; level = level->m_base.get()) {
+      chain.push_back(level);
+    }
+    std::vector<std::size_t> band(chain.size(), 0);
+    std::vector<std::int64_t> code(chain.size(), 0);
+    for (;;) {
+      // the lowest code not printed yet over all levels
+      std::size_t level = chain.size();
+      std::int64_t lowest = 0;
+      for (std::size_t i = 0; i < chain.size(); ++i) {
+        const auto& bands = chain[i]->m_bands;
+        if (band[i] < bands.size()) {
+          std::int64_t at = bands[band[i]].first + code[i];
+          if (level == chain.size() || at < lowest) {
+            level = i;
+            lowest = at;
+          }
+        }
+      }
+      if (level == chain.size()) {
+        break;
+      }
+      // the topmost level mapping the code wins
+      bool printed = false;
+      for (std::size_t i = 0; i < chain.size(); ++i) {
+        const auto& bands = chain[i]->m_bands;
+        if (band[i] >= bands.size() ||
+            bands[band[i]].first + code[i] != lowest) {
+          continue;
+        }
+        const std::uint32_t entry =
+            bands[band[i]].entries[static_cast<std::size_t>(code[i])];
+        if (++code[i] == static_cast<std::int64_t>(
+                             bands[band[i]].entries.size())) {
+          ++band[i];
+          code[i] = 0;
+        }
+        if (printed || entry == empty_entry) {
+          continue;
+        }
+        const PropertyContainer& x = *chain[i];
+        const std::string_view lexem = x.name(entry);
+        // stale pairs: the lexem got another code later, here or above
+        bool stale = x.m_entries[entry].code != lowest;
+        for (std::size_t j = 0; j < i && !stale; ++j) {
+          stale = chain[j]->owns(lexem);
+        }
+        if (!stale) {
+          fixed_width_print_line(
+              {std::string(lexem), token_code::to_string(lowest)}, 15,
+              output);
+          printed = true;
+        }
+      }
+    }
+  }
+
   /// Builds an internal map used to quickly find code by lexem
-  void build_internal_maps(const std::vector<std::string>& data,
-                           const int increment) {
-    int i = m_current_index;
+  void build_internal_maps(const std::vector<std::string>& data) {
     for (const auto& x : data) {
       append(x);
     }
@@ -111,8 +386,8 @@ class PropertyContainer {
 
   // Generates allowed symbols from data
   void gen_allowed_symbols() {
-    for (auto& x : m_lexem2code_map) {
-      for (char c : x.first) {
+    for (std::uint32_t i = 0; i < m_entries.size(); ++i) {
+      for (char c : name(i)) {
         if (!isalnum(c)) {
           allowed_symbols.insert(c);
         }
@@ -122,7 +397,15 @@ class PropertyContainer {
 
   int m_current_index;
   std::set<char> allowed_symbols;
-  std::unordered_map<int, std::string> m_code2lexem_map;
-  std::unordered_map<std::string, int> m_lexem2code_map;
+  // every lexem once, back to back
+  std::string m_chars;
+  std::vector<Entry> m_entries;
+  // lexem -> entry, a power of two in size, at most half full
+  std::vector<Slot> m_slots;
+  std::size_t m_used = 0;
+  // code -> entry, ascending by first code
+  std::vector<Band> m_bands;
+  // shared table under this one, if any
+  std::shared_ptr<const PropertyContainer> m_base;
 };
-}  // namespace translator
\ No newline at end of file
+}  // namespace translator
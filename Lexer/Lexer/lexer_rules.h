@@ -0,0 +1,653 @@
+/* Token rules and the DFA they compile to */
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "lexer_property_container.h"
+#include "lexer_scan.h"
+#include "lexer_token_code.h"
+
+namespace translator {
+
+/// What the lexer does with a match of a rule
+enum TokenRuleFlag : unsigned {
+  // not a token, e.g. whitespace or a comment. Its text isn't kept, so
+  // errors inside it have no prefix
+  RuleSkip = 1 << 0,
+  // reserved words are looked up first; one is emitted as Predefined in
+  // its canonical spelling
+  RuleReserved = 1 << 1,
+  // the char that fails to extend the match is read and dropped; the end
+  // of the source or a byte >= 0x80 there is an error
+  RuleEatsFollower = 1 << 2,
+  // may go on past a '\n', so a chunk may start inside it. Skipped rules
+  // only
+  RuleSpansLines = 1 << 3
+};
+
+/// One token definition.
+/// Patterns are regular expressions over bytes: literal chars, `.` for
+/// any byte, `[a-z]` and `[^*]` sets, `(...)` groups, `|`, and the `*`,
+/// `+` and `?` repeats. `\` escapes a special char; `\t`, `\n`, `\v`,
+/// `\f`, `\r` and `\xHH` are the control bytes.
+struct TokenRule {
+  std::string pattern;
+  TokenKind kind = TokenKind::Predefined;
+  // code of a Predefined token
+  TokenCode code = token_code::none;
+  unsigned flags = 0;
+};
+
+/// Rules in order of priority: where two rules match the same text the
+/// earlier one wins
+using TokenRules = std::vector<TokenRule>;
+
+/// Pattern matching exactly the given text
+inline std::string literal_pattern(const std::string& text) {
+  std::string pattern;
+  for (char c : text) {
+    if (!scan::is_alnum(c)) {
+      pattern += '\\';
+    }
+    pattern += c;
+  }
+  return pattern;
+}
+
+/// Minimized DFA of a rule set, with byte-class compressed tables.
+/// The lexer runs it without backtracking: a token is matched as far as
+/// the DFA goes, and if it stops in a state no rule accepts, that is an
+/// error spanning the text read so far and the byte it stopped at.
+class LexerDfa {
+ public:
+  static constexpr int dead = -1;
+
+  /// Self loop of a state the lexer skips with a scan kernel
+  enum Accel : unsigned char {
+    AccelNone,
+    AccelSpace,
+    AccelDigits,
+    AccelAlnum,
+    // every byte but `stop`
+    AccelUntil
+  };
+
+  struct State {
+    // rule accepted here, -1 if none
+    std::int16_t rule = -1;
+    Accel accel = AccelNone;
+    unsigned char stop = 0;
+    // some byte leads on
+    bool open = false;
+    // text of a token may be under way, not only skipped text
+    bool text = false;
+    // inside a rule that spans lines
+    bool spans = false;
+    // the rule accepted here takes bytes >= 0x80, which are then checked
+    // to be UTF-8
+    bool utf8 = false;
+  };
+
+  /// Compile the rules. Returns false and describes the problem in
+  /// error if they can't be compiled; the DFA is left empty then.
+  bool build(const TokenRules& rules, std::string* error = nullptr) {
+    *this = LexerDfa();
+    Nfa nfa;
+    std::string message;
+    if (!nfa.build(rules, message) || !compile(nfa, rules, message)) {
+      *this = LexerDfa();
+      if (error != nullptr) {
+        *error = message;
+      }
+      return false;
+    }
+    return true;
+  }
+
+  /// Next state on a byte, dead if none
+  inline int next(int state, char c) const {
+    return m_next[static_cast<std::size_t>(state) * m_classes +
+                  m_class[static_cast<unsigned char>(c)]];
+  }
+  inline const State& state(int state) const { return m_states[state]; }
+  inline const TokenRule& rule(int rule) const { return m_rules[rule]; }
+  static constexpr int start() { return 0; }
+  /// State a chunk starting inside a spanning rule starts in, -1 if no
+  /// rule spans lines
+  int line_state() const { return m_line_state; }
+
+  bool empty() const { return m_states.empty(); }
+  std::size_t state_count() const { return m_states.size(); }
+  std::size_t class_count() const { return m_classes; }
+
+ private:
+  /// Thompson NFA of all rules, joined by a common start node
+  struct Nfa {
+    struct Node {
+      // one byte edge and any number of empty ones
+      std::bitset<256> on;
+      int to = -1;
+      std::vector<int> empty;
+      // rule the node belongs to, -1 for the common start
+      int owner = -1;
+      bool accept = false;
+    };
+    struct Fragment {
+      int first;
+      int last;
+    };
+
+    bool build(const TokenRules& rules, std::string& error) {
+      nodes.clear();
+      owner = -1;
+      add();
+      for (std::size_t i = 0; i < rules.size(); ++i) {
+        owner = static_cast<int>(i);
+        pattern = &rules[i].pattern;
+        at = 0;
+        Fragment x;
+        if (!alternation(x) || at != pattern->size()) {
+          error = "rule " + std::to_string(i) + ": bad pattern at " +
+                  std::to_string(at) + ": " + *pattern;
+          return false;
+        }
+        nodes[0].empty.push_back(x.first);
+        nodes[x.last].accept = true;
+      }
+      return true;
+    }
+
+    int add() {
+      nodes.emplace_back();
+      nodes.back().owner = owner;
+      return static_cast<int>(nodes.size()) - 1;
+    }
+    Fragment set(const std::bitset<256>& on) {
+      int first = add();
+      int last = add();
+      nodes[first].on = on;
+      nodes[first].to = last;
+      return {first, last};
+    }
+
+    bool more() const { return at < pattern->size(); }
+    char peek() const { return (*pattern)[at]; }
+
+    bool alternation(Fragment& x) {
+      if (!sequence(x)) {
+        return false;
+      }
+      while (more() && peek() == '|') {
+        ++at;
+        Fragment y;
+        if (!sequence(y)) {
+          return false;
+        }
+        int first = add();
+        int last = add();
+        nodes[first].empty = {x.first, y.first};
+        nodes[x.last].empty.push_back(last);
+        nodes[y.last].empty.push_back(last);
+        x = {first, last};
+      }
+      return true;
+    }
+
+    bool sequence(Fragment& x) {
+      x.first = x.last = add();
+      while (more() && peek() != '|' && peek() != ')') {
+        Fragment y;
+        if (!repeat(y)) {
+          return false;
+        }
+        nodes[x.last].empty.push_back(y.first);
+        x.last = y.last;
+      }
+      return true;
+    }
+
+    bool repeat(Fragment& x) {
+      if (!atom(x)) {
+        return false;
+      }
+      while (more() && (peek() == '*' || peek() == '+' || peek() == '?')) {
+        const char op = (*pattern)[at++];
+        int first = add();
+        int last = add();
+        nodes[first].empty.push_back(x.first);
+        nodes[x.last].empty.push_back(last);
+        if (op != '+') {
+          nodes[first].empty.push_back(last);
+        }
+        if (op != '?') {
+          nodes[x.last].empty.push_back(x.first);
+        }
+        x = {first, last};
+      }
+      return true;
+    }
+
+    bool atom(Fragment& x) {
+      if (!more()) {
+        return false;
+      }
+      const char c = (*pattern)[at++];
+      std::bitset<256> on;
+      switch (c) {
+        case '(':
+          if (!alternation(x) || !more() || peek() != ')') {
+            return false;
+          }
+          ++at;
+          return true;
+        case '[':
+          if (!byte_set(on)) {
+            return false;
+          }
+          break;
+        case '.':
+          on.set();
+          break;
+        case '\\': {
+          unsigned char b;
+          if (!escape(b)) {
+            return false;
+          }
+          on.set(b);
+        } break;
+        case ')':
+        case ']':
+        case '*':
+        case '+':
+        case '?':
+          return false;
+        default:
+          on.set(static_cast<unsigned char>(c));
+          break;
+      }
+      x = set(on);
+      return true;
+    }
+
+    /// The rest of a [...] set
+    bool byte_set(std::bitset<256>& on) {
+      const bool negate = more() && peek() == '^';
+      if (negate) {
+        ++at;
+      }
+      bool first = true;
+      while (more() && (peek() != ']' || first)) {
+        first = false;
+        unsigned char low;
+        if (!set_byte(low)) {
+          return false;
+        }
+        unsigned char high = low;
+        if (at + 1 < pattern->size() && peek() == '-' &&
+            (*pattern)[at + 1] != ']') {
+          ++at;
+          if (!set_byte(high) || high < low) {
+            return false;
+          }
+        }
+        for (unsigned b = low; b <= high; ++b) {
+          on.set(b);
+        }
+      }
+      if (!more()) {
+        return false;
+      }
+      ++at;
+      if (negate) {
+        on.flip();
+      }
+      return true;
+    }
+
+    bool set_byte(unsigned char& b) {
+      const char c = (*pattern)[at++];
+      if (c == '\\') {
+        return escape(b);
+      }
+      b = static_cast<unsigned char>(c);
+      return true;
+    }
+
+    /// The rest of a \ escape
+    bool escape(unsigned char& b) {
+      if (!more()) {
+        return false;
+      }
+      const char c = (*pattern)[at++];
+      switch (c) {
+        case 't': b = '\t'; return true;
+        case 'n': b = '\n'; return true;
+        case 'v': b = '\v'; return true;
+        case 'f': b = '\f'; return true;
+        case 'r': b = '\r'; return true;
+        case 'x': {
+          unsigned value = 0;
+          for (int i = 0; i < 2; ++i) {
+            if (!more()) {
+              return false;
+            }
+            const char h = (*pattern)[at++];
+            const unsigned digit =
+                scan::is_digit(h) ? unsigned(h - '0')
+                : (h >= 'a' && h <= 'f') ? unsigned(h - 'a' + 10)
+                : (h >= 'A' && h <= 'F') ? unsigned(h - 'A' + 10)
+                                         : 16u;
+            if (digit > 15) {
+              return false;
+            }
+            value = value * 16 + digit;
+          }
+          b = static_cast<unsigned char>(value);
+          return true;
+        }
+        default:
+          if (scan::is_alnum(c)) {
+            return false;
+          }
+          b = static_cast<unsigned char>(c);
+          return true;
+      }
+    }
+
+    std::vector<Node> nodes;
+    // parser registers
+    int owner = -1;
+    const std::string* pattern = nullptr;
+    std::size_t at = 0;
+  };
+
+  /// Subset construction over byte classes, then Moore minimization
+  bool compile(const Nfa& nfa, const TokenRules& rules, std::string& error) {
+    for (std::size_t i = 0; i < rules.size(); ++i) {
+      if ((rules[i].flags & RuleSpansLines) && !(rules[i].flags & RuleSkip)) {
+        error = "rule " + std::to_string(i) + ": only skipped rules span lines";
+        return false;
+      }
+    }
+    classify(nfa);
+
+    // one representative byte per class
+    std::vector<unsigned char> sample(m_classes);
+    for (int b = 255; b >= 0; --b) {
+      sample[m_class[b]] = static_cast<unsigned char>(b);
+    }
+    auto closure = [&nfa](std::vector<int> set) {
+      std::vector<bool> seen(nfa.nodes.size());
+      for (int x : set) {
+        seen[x] = true;
+      }
+      for (std::size_t i = 0; i < set.size(); ++i) {
+        for (int y : nfa.nodes[set[i]].empty) {
+          if (!seen[y]) {
+            seen[y] = true;
+            set.push_back(y);
+          }
+        }
+      }
+      std::sort(set.begin(), set.end());
+      return set;
+    };
+
+    std::vector<std::vector<int>> sets{closure({0})};
+    std::map<std::vector<int>, int> known{{sets[0], 0}};
+    std::vector<int> next;
+    for (std::size_t q = 0; q < sets.size(); ++q) {
+      for (std::size_t k = 0; k < m_classes; ++k) {
+        std::vector<int> move;
+        for (int x : sets[q]) {
+          const auto& node = nfa.nodes[x];
+          if (node.to >= 0 && node.on.test(sample[k])) {
+            move.push_back(node.to);
+          }
+        }
+        int to = dead;
+        if (!move.empty()) {
+          move = closure(std::move(move));
+          auto found = known.find(move);
+          if (found == known.end()) {
+            found = known.emplace(move, static_cast<int>(sets.size())).first;
+            sets.push_back(move);
+          }
+          to = found->second;
+        }
+        next.push_back(to);
+      }
+    }
+
+    std::vector<State> states(sets.size());
+    for (std::size_t q = 0; q < sets.size(); ++q) {
+      State& s = states[q];
+      for (int x : sets[q]) {
+        const auto& node = nfa.nodes[x];
+        if (node.owner < 0) {
+          continue;
+        }
+        if (node.accept && (s.rule < 0 || node.owner < s.rule)) {
+          s.rule = static_cast<std::int16_t>(node.owner);
+        }
+        const unsigned flags = rules[node.owner].flags;
+        s.text = s.text || !(flags & RuleSkip);
+        s.spans = s.spans || (q != 0 && (flags & RuleSpansLines));
+      }
+    }
+    if (states[0].rule >= 0) {
+      error = "rule " + std::to_string(states[0].rule) +
+              " matches the empty text";
+      return false;
+    }
+    minimize(states, next);
+    if (m_states.size() > 0x7FFF) {
+      error = "too many states";
+      return false;
+    }
+    m_rules = rules;
+    std::vector<bool> utf8(rules.size());
+    const std::bitset<256> high = ~std::bitset<256>() << 128;
+    for (const auto& node : nfa.nodes) {
+      if (node.owner >= 0 && node.to >= 0 && (node.on & high).any()) {
+        utf8[node.owner] = true;
+      }
+    }
+    for (State& s : m_states) {
+      s.utf8 = s.rule >= 0 && utf8[s.rule];
+    }
+    return finish(error);
+  }
+
+  /// Split the bytes into classes no edge of the NFA tells apart
+  void classify(const Nfa& nfa) {
+    std::array<int, 256> cls{};
+    int count = 1;
+    for (const auto& node : nfa.nodes) {
+      if (node.to < 0) {
+        continue;
+      }
+      // (old class, on the edge) -> new class
+      std::vector<int> renumber(2 * static_cast<std::size_t>(count), -1);
+      int split = 0;
+      for (int b = 0; b < 256; ++b) {
+        int& to = renumber[2 * cls[b] + (node.on.test(b) ? 1 : 0)];
+        if (to < 0) {
+          to = split++;
+        }
+        cls[b] = to;
+      }
+      count = split;
+    }
+    for (int b = 0; b < 256; ++b) {
+      m_class[b] = static_cast<unsigned char>(cls[b]);
+    }
+    m_classes = static_cast<std::size_t>(count);
+  }
+
+  /// Merge states no input tells apart. The start state stays 0.
+  void minimize(const std::vector<State>& states, const std::vector<int>& next) {
+    const std::size_t n = states.size();
+    std::vector<int> block(n);
+    std::size_t blocks = 0;
+    {
+      std::map<std::tuple<int, bool, bool>, int> initial;
+      for (std::size_t q = 0; q < n; ++q) {
+        auto key = std::make_tuple(int(states[q].rule), states[q].text,
+                                   states[q].spans);
+        block[q] = initial.emplace(key, static_cast<int>(initial.size()))
+                       .first->second;
+      }
+      blocks = initial.size();
+    }
+    for (;;) {
+      std::map<std::vector<int>, int> refined;
+      std::vector<int> split(n);
+      for (std::size_t q = 0; q < n; ++q) {
+        std::vector<int> key{block[q]};
+        for (std::size_t k = 0; k < m_classes; ++k) {
+          const int to = next[q * m_classes + k];
+          key.push_back(to == dead ? dead : block[to]);
+        }
+        split[q] = refined.emplace(std::move(key),
+                                   static_cast<int>(refined.size()))
+                       .first->second;
+      }
+      block = std::move(split);
+      if (refined.size() == blocks) {
+        break;
+      }
+      blocks = refined.size();
+    }
+    // blocks were numbered by first state, so the start state's is 0
+    m_states.assign(blocks, State());
+    m_next.assign(blocks * m_classes, dead);
+    for (std::size_t q = 0; q < n; ++q) {
+      const auto b = static_cast<std::size_t>(block[q]);
+      m_states[b] = states[q];
+      for (std::size_t k = 0; k < m_classes; ++k) {
+        const int to = next[q * m_classes + k];
+        m_next[b * m_classes + k] =
+            static_cast<std::int16_t>(to == dead ? dead : block[to]);
+      }
+    }
+  }
+
+  /// Work out what the lexer needs per state
+  bool finish(std::string& error) {
+    m_line_state = -1;
+    for (std::size_t q = 0; q < m_states.size(); ++q) {
+      const int state = static_cast<int>(q);
+      State& s = m_states[q];
+      std::bitset<256> loop;
+      for (int b = 0; b < 256; ++b) {
+        const int to = next(state, static_cast<char>(b));
+        s.open = s.open || to != dead;
+        loop.set(b, to == state);
+      }
+      s.accel = AccelNone;
+      if (loop == byte_set(scan::is_space)) {
+        s.accel = AccelSpace;
+      } else if (loop == byte_set(scan::is_digit)) {
+        s.accel = AccelDigits;
+      } else if (loop == byte_set(scan::is_alnum)) {
+        s.accel = AccelAlnum;
+      } else if (loop.count() == 255) {
+        s.accel = AccelUntil;
+        for (int b = 0; b < 256; ++b) {
+          if (!loop.test(b)) {
+            s.stop = static_cast<unsigned char>(b);
+          }
+        }
+      }
+      if (!s.spans) {
+        continue;
+      }
+      // chunks start right after a '\n'
+      const int to = next(state, '\n');
+      if (to == dead) {
+        continue;
+      }
+      if (m_line_state >= 0 && m_line_state != to) {
+        error = "rules that span lines must meet in one state after a '\\n'";
+        return false;
+      }
+      m_line_state = to;
+    }
+    return true;
+  }
+
+  template <typename Is>
+  static std::bitset<256> byte_set(Is is) {
+    std::bitset<256> set;
+    for (int b = 0; b < 256; ++b) {
+      set.set(b, is(static_cast<char>(b)));
+    }
+    return set;
+  }
+
+  TokenRules m_rules;
+  std::array<unsigned char, 256> m_class{};
+  std::size_t m_classes = 0;
+  // state * m_classes + class -> state
+  std::vector<std::int16_t> m_next;
+  std::vector<State> m_states;
+  int m_line_state = -1;
+};
+
+/// Rules of SIGNAL with the email extension. Delimiters are the
+/// non-alphanumeric lexems of the predefined table.
+inline TokenRules signal_rules(const PropertyContainer& predefined_lexem) {
+  TokenRules rules = {
+      {"[ \\t\\n\\v\\f\\r]+", TokenKind::Predefined, -1, RuleSkip},
+      // (* ... *); the "*)" may start right at the '('
+      {"\\(([^*]|\\*+[^*)])*\\*+\\)", TokenKind::Predefined, -1,
+       RuleSkip | RuleSpansLines},
+      {"[0-9]+", TokenKind::Constant, -1, 0},
+      {"[A-Za-z][A-Za-z0-9]*", TokenKind::Identifier, -1, RuleReserved},
+      // custom
+      {"[A-Za-z][A-Za-z0-9]*@[A-Za-z0-9]*\\.[A-Za-z0-9]*", TokenKind::Email,
+       -1, 0}};
+  predefined_lexem.for_each([&rules](const std::string& lexem,
+                                     TokenCode code) {
+    if (!lexem.empty() && !scan::is_alnum(lexem[0])) {
+      rules.push_back({literal_pattern(lexem), TokenKind::Predefined, code,
+                       RuleEatsFollower});
+    }
+  });
+  return rules;
+}
+
+/// Compiled signal_rules(), built once per distinct delimiter set
+inline std::shared_ptr<const LexerDfa> signal_dfa(
+    const PropertyContainer& predefined_lexem) {
+  static std::mutex guard;
+  static std::map<std::string, std::shared_ptr<const LexerDfa>> compiled;
+  std::string key;
+  predefined_lexem.for_each([&key](const std::string& lexem, TokenCode code) {
+    if (!lexem.empty() && !scan::is_alnum(lexem[0])) {
+      key += std::to_string(code);
+      key += ' ';
+      key += lexem;
+      key += '\n';
+    }
+  });
+  std::lock_guard<std::mutex> lock(guard);
+  auto& dfa = compiled[key];
+  if (dfa == nullptr) {
+    auto built = std::make_shared<LexerDfa>();
+    built->build(signal_rules(predefined_lexem));
+    dfa = std::move(built);
+  }
+  return dfa;
+}
+}  // namespace translator
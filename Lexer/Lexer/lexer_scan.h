@@ -0,0 +1,495 @@
+/* Vectorized run scanning */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(_M_X64) || defined(__x86_64__) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define TRANSLATOR_SCAN_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#else
+#define TRANSLATOR_SCAN_X86 0
+#endif
+
+#if TRANSLATOR_SCAN_X86 && (defined(__GNUC__) || defined(__clang__))
+#define TRANSLATOR_TARGET_AVX2 __attribute__((target("avx2,popcnt")))
+#else
+#define TRANSLATOR_TARGET_AVX2
+#endif
+
+namespace translator {
+namespace scan {
+
+/// Newlines in a scanned range
+struct LineInfo {
+  // number of '\n'
+  std::size_t rows = 0;
+  // one past the last '\n' or '\r', nullptr if there is none
+  const char* line_start = nullptr;
+  // UTF-8 continuation bytes from line_start on, or in the whole range
+  // if it has no line break; columns count the other bytes
+  std::size_t continuations = 0;
+};
+
+/// Kernels that find the end of a run of one char class.
+/// Each returns the first char outside the run, or end.
+struct Kernels {
+  const char* (*skip_space)(const char*, const char*);
+  const char* (*skip_digits)(const char*, const char*);
+  const char* (*skip_alnum)(const char*, const char*);
+  const char* (*skip_ascii)(const char*, const char*);
+  LineInfo (*count_lines)(const char*, const char*);
+  /// Append the offsets from origin of every '\n', every '\r' and
+  /// every UTF-8 continuation byte
+  void (*line_breaks)(const char*,
+                      const char*,
+                      const char* origin,
+                      std::vector<std::uint64_t>& newlines,
+                      std::vector<std::uint64_t>& returns,
+                      std::vector<std::uint64_t>& continuations);
+  const char* name;
+};
+
+// Char classes. The DFA skips a self loop with a kernel when the loop is
+// exactly one of them.
+inline bool is_space(char c) {
+  return c == ' ' || static_cast<unsigned char>(c - '\t') <= '\r' - '\t';
+}
+inline bool is_digit(char c) {
+  return static_cast<unsigned char>(c - '0') <= 9;
+}
+inline bool is_alnum(char c) {
+  return is_digit(c) || static_cast<unsigned char>((c | 0x20) - 'a') <= 25;
+}
+inline bool is_ascii(char c) { return static_cast<unsigned char>(c) < 0x80; }
+/// Second to fourth byte of a UTF-8 sequence, 10xxxxxx
+inline bool is_continuation(char c) {
+  return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+}
+
+inline int lowest_bit(std::uint32_t x) {
+#ifdef _MSC_VER
+  unsigned long i;
+  _BitScanForward(&i, x);
+  return static_cast<int>(i);
+#else
+  return __builtin_ctz(x);
+#endif
+}
+
+inline int highest_bit(std::uint32_t x) {
+#ifdef _MSC_VER
+  unsigned long i;
+  _BitScanReverse(&i, x);
+  return static_cast<int>(i);
+#else
+  return 31 - __builtin_clz(x);
+#endif
+}
+
+inline int popcount(std::uint32_t x) {
+  x = x - ((x >> 1) & 0x55555555u);
+  x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+  return static_cast<int>((((x + (x >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24);
+}
+
+// Scalar kernels. Also used for the tails of the vector ones.
+
+inline const char* skip_space_scalar(const char* p, const char* end) {
+  while (p != end && is_space(*p)) {
+    ++p;
+  }
+  return p;
+}
+
+inline const char* skip_digits_scalar(const char* p, const char* end) {
+  while (p != end && is_digit(*p)) {
+    ++p;
+  }
+  return p;
+}
+
+inline const char* skip_alnum_scalar(const char* p, const char* end) {
+  while (p != end && is_alnum(*p)) {
+    ++p;
+  }
+  return p;
+}
+
+inline const char* skip_ascii_scalar(const char* p, const char* end) {
+  while (p != end && is_ascii(*p)) {
+    ++p;
+  }
+  return p;
+}
+
+inline LineInfo count_lines_scalar(const char* p, const char* end) {
+  LineInfo info;
+  for (; p != end; ++p) {
+    if (*p == '\n') {
+      ++info.rows;
+      info.line_start = p + 1;
+      info.continuations = 0;
+    } else if (*p == '\r') {
+      info.line_start = p + 1;
+      info.continuations = 0;
+    } else if (is_continuation(*p)) {
+      ++info.continuations;
+    }
+  }
+  return info;
+}
+
+/// Add the line info of a range to that of the range before it
+inline void append_lines(LineInfo& info, const LineInfo& next) {
+  info.rows += next.rows;
+  if (next.line_start) {
+    info.line_start = next.line_start;
+    info.continuations = next.continuations;
+  } else {
+    info.continuations += next.continuations;
+  }
+}
+
+inline void line_breaks_scalar(const char* p,
+                               const char* end,
+                               const char* origin,
+                               std::vector<std::uint64_t>& newlines,
+                               std::vector<std::uint64_t>& returns,
+                               std::vector<std::uint64_t>& continuations) {
+  for (; p != end; ++p) {
+    if (*p == '\n') {
+      newlines.push_back(static_cast<std::uint64_t>(p - origin));
+    } else if (*p == '\r') {
+      returns.push_back(static_cast<std::uint64_t>(p - origin));
+    } else if (is_continuation(*p)) {
+      continuations.push_back(static_cast<std::uint64_t>(p - origin));
+    }
+  }
+}
+
+/// Append base + the position of every set bit of mask
+inline void push_bits(std::uint32_t mask,
+                      std::uint64_t base,
+                      std::vector<std::uint64_t>& out) {
+  while (mask) {
+    out.push_back(base + static_cast<std::uint64_t>(lowest_bit(mask)));
+    mask &= mask - 1;
+  }
+}
+
+#if TRANSLATOR_SCAN_X86
+
+// SSE2 kernels, 16 bytes at a time.
+// Range checks are done as unsigned "min(x, hi) == x" on biased bytes.
+
+inline __m128i in_range_sse2(__m128i v, char lo, char count) {
+  __m128i biased = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+  return _mm_cmpeq_epi8(_mm_min_epu8(biased, _mm_set1_epi8(count)), biased);
+}
+
+inline std::uint32_t space_mask_sse2(__m128i v) {
+  __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                           in_range_sse2(v, '\t', '\r' - '\t'));
+  return static_cast<std::uint32_t>(_mm_movemask_epi8(m));
+}
+
+inline std::uint32_t digit_mask_sse2(__m128i v) {
+  return static_cast<std::uint32_t>(_mm_movemask_epi8(in_range_sse2(v, '0', 9)));
+}
+
+inline std::uint32_t alnum_mask_sse2(__m128i v) {
+  __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+  __m128i m = _mm_or_si128(in_range_sse2(v, '0', 9),
+                           in_range_sse2(lower, 'a', 25));
+  return static_cast<std::uint32_t>(_mm_movemask_epi8(m));
+}
+
+template <std::uint32_t (*Mask)(__m128i), const char* (*Tail)(const char*, const char*)>
+inline const char* skip_sse2(const char* p, const char* end) {
+  while (end - p >= 16) {
+    std::uint32_t outside =
+        ~Mask(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) & 0xFFFFu;
+    if (outside) {
+      return p + lowest_bit(outside);
+    }
+    p += 16;
+  }
+  return Tail(p, end);
+}
+
+inline const char* skip_space_sse2(const char* p, const char* end) {
+  return skip_sse2<space_mask_sse2, skip_space_scalar>(p, end);
+}
+inline const char* skip_digits_sse2(const char* p, const char* end) {
+  return skip_sse2<digit_mask_sse2, skip_digits_scalar>(p, end);
+}
+inline const char* skip_alnum_sse2(const char* p, const char* end) {
+  return skip_sse2<alnum_mask_sse2, skip_alnum_scalar>(p, end);
+}
+
+inline const char* skip_ascii_sse2(const char* p, const char* end) {
+  while (end - p >= 16) {
+    // the sign bit is set exactly on bytes >= 0x80
+    std::uint32_t outside = static_cast<std::uint32_t>(_mm_movemask_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p))));
+    if (outside) {
+      return p + lowest_bit(outside);
+    }
+    p += 16;
+  }
+  return skip_ascii_scalar(p, end);
+}
+
+/// Continuation bytes are -128..-65 as signed bytes. Only called on
+/// blocks that aren't pure ASCII.
+inline std::uint32_t continuation_mask_sse2(__m128i v) {
+  return static_cast<std::uint32_t>(
+      _mm_movemask_epi8(_mm_cmplt_epi8(v, _mm_set1_epi8(-64))));
+}
+
+inline LineInfo count_lines_sse2(const char* p, const char* end) {
+  LineInfo info;
+  while (end - p >= 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i nl = _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'));
+    __m128i cr = _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'));
+    std::uint32_t nl_mask = static_cast<std::uint32_t>(_mm_movemask_epi8(nl));
+    std::uint32_t br_mask =
+        static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_or_si128(nl, cr)));
+    info.rows += popcount(nl_mask);
+    // pure ASCII blocks have no continuation bytes to count
+    std::uint32_t cont_mask =
+        _mm_movemask_epi8(v) ? continuation_mask_sse2(v) : 0;
+    if (br_mask) {
+      const int last = highest_bit(br_mask);
+      info.line_start = p + last + 1;
+      info.continuations = 0;
+      cont_mask = last < 15 ? cont_mask >> (last + 1) : 0;
+    }
+    info.continuations += popcount(cont_mask);
+    p += 16;
+  }
+  append_lines(info, count_lines_scalar(p, end));
+  return info;
+}
+
+inline void line_breaks_sse2(const char* p,
+                             const char* end,
+                             const char* origin,
+                             std::vector<std::uint64_t>& newlines,
+                             std::vector<std::uint64_t>& returns,
+                             std::vector<std::uint64_t>& continuations) {
+  while (end - p >= 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    std::uint32_t nl_mask = static_cast<std::uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))));
+    std::uint32_t cr_mask = static_cast<std::uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+    const std::uint64_t base = static_cast<std::uint64_t>(p - origin);
+    push_bits(nl_mask, base, newlines);
+    push_bits(cr_mask, base, returns);
+    if (_mm_movemask_epi8(v)) {
+      push_bits(continuation_mask_sse2(v), base, continuations);
+    }
+    p += 16;
+  }
+  line_breaks_scalar(p, end, origin, newlines, returns, continuations);
+}
+
+// AVX2 kernels, 32 bytes at a time.
+
+TRANSLATOR_TARGET_AVX2 inline __m256i in_range_avx2(__m256i v, char lo, char count) {
+  __m256i biased = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+  return _mm256_cmpeq_epi8(_mm256_min_epu8(biased, _mm256_set1_epi8(count)),
+                           biased);
+}
+
+TRANSLATOR_TARGET_AVX2 inline std::uint32_t space_mask_avx2(__m256i v) {
+  __m256i m = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                              in_range_avx2(v, '\t', '\r' - '\t'));
+  return static_cast<std::uint32_t>(_mm256_movemask_epi8(m));
+}
+
+TRANSLATOR_TARGET_AVX2 inline std::uint32_t digit_mask_avx2(__m256i v) {
+  return static_cast<std::uint32_t>(
+      _mm256_movemask_epi8(in_range_avx2(v, '0', 9)));
+}
+
+TRANSLATOR_TARGET_AVX2 inline std::uint32_t alnum_mask_avx2(__m256i v) {
+  __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+  __m256i m = _mm256_or_si256(in_range_avx2(v, '0', 9),
+                              in_range_avx2(lower, 'a', 25));
+  return static_cast<std::uint32_t>(_mm256_movemask_epi8(m));
+}
+
+TRANSLATOR_TARGET_AVX2 inline const char* skip_space_avx2(const char* p,
+                                                          const char* end) {
+  while (end - p >= 32) {
+    std::uint32_t outside = ~space_mask_avx2(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+    if (outside) {
+      return p + lowest_bit(outside);
+    }
+    p += 32;
+  }
+  return skip_space_sse2(p, end);
+}
+
+TRANSLATOR_TARGET_AVX2 inline const char* skip_digits_avx2(const char* p,
+                                                           const char* end) {
+  while (end - p >= 32) {
+    std::uint32_t outside = ~digit_mask_avx2(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+    if (outside) {
+      return p + lowest_bit(outside);
+    }
+    p += 32;
+  }
+  return skip_digits_sse2(p, end);
+}
+
+TRANSLATOR_TARGET_AVX2 inline const char* skip_alnum_avx2(const char* p,
+                                                          const char* end) {
+  while (end - p >= 32) {
+    std::uint32_t outside = ~alnum_mask_avx2(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+    if (outside) {
+      return p + lowest_bit(outside);
+    }
+    p += 32;
+  }
+  return skip_alnum_sse2(p, end);
+}
+
+TRANSLATOR_TARGET_AVX2 inline const char* skip_ascii_avx2(const char* p,
+                                                          const char* end) {
+  while (end - p >= 32) {
+    std::uint32_t outside = static_cast<std::uint32_t>(_mm256_movemask_epi8(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))));
+    if (outside) {
+      return p + lowest_bit(outside);
+    }
+    p += 32;
+  }
+  return skip_ascii_sse2(p, end);
+}
+
+TRANSLATOR_TARGET_AVX2 inline std::uint32_t continuation_mask_avx2(__m256i v) {
+  return static_cast<std::uint32_t>(_mm256_movemask_epi8(
+      _mm256_cmpgt_epi8(_mm256_set1_epi8(-64), v)));
+}
+
+TRANSLATOR_TARGET_AVX2 inline int popcount_avx2(std::uint32_t x) {
+#ifdef _MSC_VER
+  return static_cast<int>(__popcnt(x));
+#else
+  return __builtin_popcount(x);
+#endif
+}
+
+TRANSLATOR_TARGET_AVX2 inline LineInfo count_lines_avx2(const char* p,
+                                                        const char* end) {
+  LineInfo info;
+  while (end - p >= 32) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i nl = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'));
+    __m256i cr = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'));
+    std::uint32_t nl_mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(nl));
+    std::uint32_t br_mask = static_cast<std::uint32_t>(
+        _mm256_movemask_epi8(_mm256_or_si256(nl, cr)));
+    info.rows += popcount_avx2(nl_mask);
+    std::uint32_t cont_mask =
+        _mm256_movemask_epi8(v) ? continuation_mask_avx2(v) : 0;
+    if (br_mask) {
+      const int last = highest_bit(br_mask);
+      info.line_start = p + last + 1;
+      info.continuations = 0;
+      cont_mask = last < 31 ? cont_mask >> (last + 1) : 0;
+    }
+    info.continuations += popcount_avx2(cont_mask);
+    p += 32;
+  }
+  append_lines(info, count_lines_sse2(p, end));
+  return info;
+}
+
+TRANSLATOR_TARGET_AVX2 inline void line_breaks_avx2(
+    const char* p,
+    const char* end,
+    const char* origin,
+    std::vector<std::uint64_t>& newlines,
+    std::vector<std::uint64_t>& returns,
+    std::vector<std::uint64_t>& continuations) {
+  while (end - p >= 32) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    std::uint32_t nl_mask = static_cast<std::uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))));
+    std::uint32_t cr_mask = static_cast<std::uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'))));
+    const std::uint64_t base = static_cast<std::uint64_t>(p - origin);
+    push_bits(nl_mask, base, newlines);
+    push_bits(cr_mask, base, returns);
+    if (_mm256_movemask_epi8(v)) {
+      push_bits(continuation_mask_avx2(v), base, continuations);
+    }
+    p += 32;
+  }
+  line_breaks_sse2(p, end, origin, newlines, returns, continuations);
+}
+
+/// Check the CPU and the OS for AVX2 support
+inline bool cpu_has_avx2() {
+#ifdef _MSC_VER
+  int regs[4];
+  __cpuid(regs, 0);
+  if (regs[0] < 7) {
+    return false;
+  }
+  __cpuid(regs, 1);
+  // OSXSAVE and AVX
+  if ((regs[2] & (1 << 27)) == 0 || (regs[2] & (1 << 28)) == 0) {
+    return false;
+  }
+  // XMM and YMM state enabled by the OS
+  if ((_xgetbv(0) & 6) != 6) {
+    return false;
+  }
+  __cpuidex(regs, 7, 0);
+  return (regs[1] & (1 << 5)) != 0;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif  // TRANSLATOR_SCAN_X86
+
+inline Kernels select_kernels() {
+#if TRANSLATOR_SCAN_X86
+  if (cpu_has_avx2()) {
+    return {skip_space_avx2, skip_digits_avx2, skip_alnum_avx2,
+            skip_ascii_avx2, count_lines_avx2, line_breaks_avx2,
+            "avx2"};
+  }
+  return {skip_space_sse2, skip_digits_sse2, skip_alnum_sse2,
+          skip_ascii_sse2, count_lines_sse2, line_breaks_sse2,
+          "sse2"};
+#else
+  return {skip_space_scalar, skip_digits_scalar, skip_alnum_scalar,
+          skip_ascii_scalar, count_lines_scalar, line_breaks_scalar,
+          "scalar"};
+#endif
+}
+
+/// Kernels for this CPU, selected on first use
+inline const Kernels& kernels() {
+  static const Kernels selected = select_kernels();
+  return selected;
+}
+
+}  // namespace scan
+}  // namespace translator
@@ -0,0 +1,232 @@
+/* Source file input */
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace translator {
+
+/// Read-only contiguous view of a whole source.
+/// Regular files are memory-mapped; anything that can't be mapped (pipes,
+/// character devices, streams) is read into one owned buffer instead.
+class SourceBuffer {
+ public:
+  SourceBuffer() = default;
+  explicit SourceBuffer(const std::string& filename) { open(filename); }
+  explicit SourceBuffer(std::istream& stream) { read(stream); }
+  ~SourceBuffer() { close(); }
+
+  SourceBuffer(const SourceBuffer&) = delete;
+  SourceBuffer& operator=(const SourceBuffer&) = delete;
+  SourceBuffer(SourceBuffer&& rhs) noexcept { swap(rhs); }
+  SourceBuffer& operator=(SourceBuffer&& rhs) noexcept {
+    if (this != &rhs) {
+      close();
+      swap(rhs);
+    }
+    return *this;
+  }
+
+  /// Map the file, falling back to reading it if mapping is impossible.
+  /// Returns false if the file can't be opened at all.
+  bool open(const std::string& filename) {
+    close();
+    if (map(filename)) {
+      return true;
+    }
+    std::ifstream file(filename, std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+      return false;
+    }
+    return read(file);
+  }
+
+  /// Read the rest of the stream into the owned buffer
+  bool read(std::istream& stream) {
+    close();
+    m_buffer.assign(std::istreambuf_iterator<char>(stream),
+                    std::istreambuf_iterator<char>());
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+    m_open = true;
+    return true;
+  }
+
+  void close() {
+#ifdef _WIN32
+    if (m_mapped) {
+      UnmapViewOfFile(m_data);
+    }
+#else
+    if (m_mapped) {
+      munmap(const_cast<char*>(m_data), m_size);
+    }
+#endif
+    m_buffer.clear();
+    m_data = nullptr;
+    m_size = 0;
+    m_mapped = false;
+    m_open = false;
+  }
+
+  const char* begin() const { return m_data; }
+  const char* end() const { return m_data + m_size; }
+  std::size_t size() const { return m_size; }
+  bool is_open() const { return m_open; }
+  bool is_mapped() const { return m_mapped; }
+
+ private:
+  /// Map a regular non-empty file. Returns false when mapping isn't possible.
+  bool map(const std::string& filename) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                              nullptr, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+      return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0 ||
+        GetFileType(file) != FILE_TYPE_DISK) {
+      CloseHandle(file);
+      return false;
+    }
+    HANDLE mapping =
+        CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (mapping == nullptr) {
+      return false;
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (view == nullptr) {
+      return false;
+    }
+    m_data = static_cast<const char*>(view);
+    m_size = static_cast<std::size_t>(size.QuadPart);
+#else
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size == 0) {
+      ::close(fd);
+      return false;
+    }
+    void* view = mmap(nullptr, static_cast<std::size_t>(info.st_size),
+                      PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED) {
+      return false;
+    }
+#ifdef MADV_SEQUENTIAL
+    madvise(view, static_cast<std::size_t>(info.st_size), MADV_SEQUENTIAL);
+#endif
+    m_data = static_cast<const char*>(view);
+    m_size = static_cast<std::size_t>(info.st_size);
+#endif
+    m_mapped = true;
+    m_open = true;
+    return true;
+  }
+
+  void swap(SourceBuffer& rhs) noexcept {
+    std::swap(m_buffer, rhs.m_buffer);
+    std::swap(m_data, rhs.m_data);
+    std::swap(m_size, rhs.m_size);
+    std::swap(m_mapped, rhs.m_mapped);
+    std::swap(m_open, rhs.m_open);
+    // the owned buffer moved, so the data pointers have to follow it
+    if (!m_mapped && m_open) {
+      m_data = m_buffer.data();
+    }
+    if (!rhs.m_mapped && rhs.m_open) {
+      rhs.m_data = rhs.m_buffer.data();
+    }
+  }
+
+  std::string m_buffer;
+  const char* m_data = nullptr;
+  std::size_t m_size = 0;
+  bool m_mapped = false;
+  bool m_open = false;
+};
+
+/// Sliding window over a stream of any length, e.g. a pipe.
+/// The stream is read in large blocks into a fixed buffer; the bytes not
+/// consumed yet move to its front before the next read. The buffer only
+/// grows when nothing of a full window could be consumed.
+class SourceStream {
+ public:
+  explicit SourceStream(std::istream& stream,
+                        const std::size_t capacity = 1 << 20)
+      : m_stream(stream), m_buffer(std::max<std::size_t>(capacity, 1)) {}
+
+  /// Read more of the stream behind the bytes not consumed yet.
+  /// Returns false once the stream is exhausted and nothing is left.
+  bool fill() {
+    const std::size_t kept = m_size - m_consumed;
+    if (m_consumed > 0) {
+      std::memmove(m_buffer.data(), m_buffer.data() + m_consumed, kept);
+      m_base += m_consumed;
+      m_consumed = 0;
+    }
+    m_size = kept;
+    if (m_size == m_buffer.size()) {
+      m_buffer.resize(m_buffer.size() * 2);
+    }
+    while (!m_eof && m_size < m_buffer.size()) {
+      m_stream.read(m_buffer.data() + m_size,
+                    static_cast<std::streamsize>(m_buffer.size() - m_size));
+      m_size += static_cast<std::size_t>(m_stream.gcount());
+      m_eof = !m_stream;
+    }
+    return m_size > 0;
+  }
+
+  /// Mark the window up to `to` as read
+  void consume(const char* to) {
+    m_consumed = static_cast<std::size_t>(to - m_buffer.data());
+  }
+
+  /// Bytes read but not consumed yet
+  const char* begin() const { return m_buffer.data() + m_consumed; }
+  const char* end() const { return m_buffer.data() + m_size; }
+  /// Offset of begin() in the stream
+  std::uint64_t offset() const { return m_base + m_consumed; }
+  /// Nothing is left in the stream past end()
+  bool eof() const { return m_eof; }
+
+ private:
+  std::istream& m_stream;
+  std::vector<char> m_buffer;
+  // stream offset of the buffer start
+  std::uint64_t m_base = 0;
+  std::size_t m_size = 0;
+  std::size_t m_consumed = 0;
+  bool m_eof = false;
+};
+}  // namespace translator
@@ -0,0 +1,204 @@
+/* Streaming lexer for sources of any length */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include "lexer_automaton.h"
+#include "lexer_data.h"
+#include "lexer_source.h"
+
+namespace translator {
+
+/// Lexes a stream, e.g. a pipe, in a sliding window and writes the token
+/// table as print_results would while the tokens come, so memory stays
+/// flat however long the stream is. Only the code table grows, with the
+/// number of distinct names.
+/// Every window is cut right after its last '\n' and lexed as a chunk,
+/// as ParallelLexer does: no token but a comment goes on past a '\n', and
+/// a comment is carried into the next window as its entry state. The
+/// bytes after the cut stay for the next window. A line longer than the
+/// window makes the window grow to hold it.
+/// Codes, rows, columns and errors are the ones a run on the whole
+/// source gives.
+class StreamLexer {
+ public:
+  StreamLexer(std::shared_ptr<const PropertyContainer> predefined_lexem,
+              const std::size_t window = 1 << 20,
+              std::shared_ptr<const LexerDfa> rules = nullptr)
+      : m_window(window),
+        m_main(nullptr, nullptr, predefined_lexem, rules),
+        m_chunk(nullptr, nullptr, std::move(predefined_lexem), rules) {}
+
+  /// Stream lexer errors are printed to, std::cout by default
+  void set_error_output(std::ostream& output) { m_error_output = &output; }
+  void set_diagnostic_limits(const DiagnosticLimits& limits) {
+    m_main.set_diagnostic_limits(limits);
+    m_chunk.set_diagnostic_limits(limits);
+  }
+  void set_diagnostic_renderer(DiagnosticRenderer renderer) {
+    m_main.set_diagnostic_renderer(renderer);
+  }
+  /// Codes shared with other lexers, see LexerAutomaton::set_intern_table
+  void set_intern_table(std::shared_ptr<InternTable> table) {
+    m_main.set_intern_table(std::move(table));
+  }
+
+  /// Lex the rest of the input, writing the tables to output.
+  /// Returns the number of tokens.
+  std::uint64_t run(std::istream& input, std::ostream& output) {
+    m_main.reset(nullptr, nullptr);
+    m_rows = 0;
+    m_tokens = 0;
+    m_in_comment = false;
+    m_offset_start = 0;
+    m_carried = {};
+    m_held = {};
+    print_lexem_list_header(output);
+    SourceStream source(input, m_window);
+    bool done = false;
+    while (!done) {
+      source.fill();
+      // the last window may be empty, to end a comment left open
+      const bool last = source.eof();
+      const char* cut = source.end();
+      if (!last) {
+        cut = last_line_end(source.begin(), source.end());
+        if (cut == nullptr) {
+          // no whole line yet: read on into a bigger window
+          continue;
+        }
+      }
+      done = lex_window(source.offset(), source.begin(), cut, last, output) ||
+             last;
+      source.consume(cut);
+    }
+    LexemData& data = m_main.m_data;
+    data.diagnostics.flush_dropped(*m_error_output);
+    print_lexem_table(data.lexem_codes, output);
+    return m_tokens;
+  }
+
+ private:
+  /// Position and span prefix of an offset before the current window
+  struct Remembered {
+    std::uint64_t offset = ~std::uint64_t(0);
+    LinePosition at{0, 0};
+    std::string text;
+  };
+
+  /// One past the last '\n' in [begin, end), nullptr if there is none
+  static const char* last_line_end(const char* begin, const char* end) {
+    for (const char* x = end; x != begin; --x) {
+      if (x[-1] == '\n') {
+        return x;
+      }
+    }
+    return nullptr;
+  }
+
+  /// Lex [begin, end), which starts at offset base of the stream, and
+  /// write out its tokens. Returns true if lexing stopped inside it.
+  bool lex_window(const std::uint64_t base,
+                  const char* begin,
+                  const char* end,
+                  const bool last,
+                  std::ostream& output) {
+    m_chunk.reset(begin, end);
+    const LexerChunk chunk = m_chunk.lex_chunk(m_in_comment, last);
+    const LineIndex& lines = *chunk.tokens.lines();
+    // windows start on a new line, so only rows move
+    auto locate = [&](std::uint64_t offset) {
+      if (offset < base) {
+        return remembered(offset);
+      }
+      LinePosition at = lines.locate(offset - base);
+      at.row += m_rows;
+      return at;
+    };
+
+    LexemData& data = m_main.m_data;
+    const std::vector<Diagnostic>& diagnostics =
+        chunk.diagnostics.diagnostics();
+    for (std::size_t j = 0; j < diagnostics.size(); ++j) {
+      Diagnostic diagnostic = diagnostics[j];
+      const std::uint64_t span_end =
+          base + diagnostic.offset + diagnostic.length;
+      diagnostic.offset = chunk.unpositioned(j)
+                              ? m_offset_start
+                              : base + diagnostic.offset;
+      diagnostic.length = span_end - diagnostic.offset;
+      data.diagnostics.report(diagnostic);
+    }
+    data.diagnostics.add_dropped(chunk.diagnostics.dropped());
+
+    const TokenStore& tokens = chunk.tokens;
+    for (std::size_t j = 0; j < tokens.size(); ++j) {
+      const std::string& name = tokens.name(j);
+      const TokenCode code =
+          m_main.assign_code(chunk.kinds[j], name, tokens.symbol(j));
+      data.add_lexem(name, code);
+      const LinePosition at = tokens.position(j);
+      print_lexem_row(name, code, at.row + m_rows, at.column, output);
+    }
+    m_tokens += tokens.size();
+
+    // the last diagnostic may still merge with the first one of the next
+    // window if its span reaches the cut
+    const auto window_end = base + static_cast<std::uint64_t>(end - begin);
+    const std::vector<Diagnostic>& kept = data.diagnostics.diagnostics();
+    const bool hold = !last && !chunk.halted && !kept.empty() &&
+                      kept.back().offset + kept.back().length == window_end;
+    auto text = [&](const Diagnostic& x) {
+      if (x.offset < base) {
+        // errors carried over from an earlier window have no prefix
+        return x.offset == m_held.offset ? std::string_view(m_held.text)
+                                         : std::string_view();
+      }
+      return std::string_view(begin + (x.offset - base),
+                              static_cast<std::size_t>(x.prefix));
+    };
+    data.diagnostics.flush_some(*m_error_output, text, locate, hold ? 1 : 0);
+    if (hold && kept.back().offset != m_held.offset) {
+      const Diagnostic& x = kept.back();
+      m_held.offset = x.offset;
+      m_held.at = locate(x.offset);
+      m_held.text = std::string(text(x));
+    }
+
+    if (chunk.has_position && !last) {
+      m_offset_start = base + chunk.offset_start;
+      m_carried.offset = m_offset_start;
+      m_carried.at = locate(m_offset_start);
+    }
+    m_in_comment = chunk.in_comment;
+    m_rows += lines.rows();
+    return chunk.halted;
+  }
+
+  /// Position of a diagnostic or token start from an earlier window
+  LinePosition remembered(const std::uint64_t offset) const {
+    return offset == m_held.offset ? m_held.at : m_carried.at;
+  }
+
+  std::size_t m_window;
+  // assigns the codes and collects the errors of the whole stream
+  LexerAutomaton m_main;
+  // lexes one window at a time
+  LexerAutomaton m_chunk;
+  std::ostream* m_error_output = &std::cout;
+  // rows before the current window
+  std::int64_t m_rows = 0;
+  std::uint64_t m_tokens = 0;
+  bool m_in_comment = false;
+  // last token start so far, where errors raised before the first token
+  // start of a window are reported
+  std::uint64_t m_offset_start = 0;
+  Remembered m_carried;
+  // the diagnostic left open at the last cut
+  Remembered m_held;
+};
+}  // namespace translator
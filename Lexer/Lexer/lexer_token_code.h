@@ -0,0 +1,105 @@
+/* Tagged token codes */
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace translator {
+
+/// How a token gets its code
+enum class TokenKind : unsigned char {
+  // fixed code from the lexem table
+  Predefined,
+  Constant,
+  Identifier,
+  Email
+};
+
+/// Code of a token: its kind in the high 32 bits and an index within the
+/// kind in the low 32. A predefined code is just its index, so ';' is
+/// still 59 and PROGRAM 401. Every other kind numbers its names from 0
+/// and has room for 2^32 of them. Codes order by kind first, as the old
+/// bands 500+, 1000+ and 2000+ did. -1 means no code.
+using TokenCode = std::int64_t;
+
+namespace token_code {
+
+constexpr TokenCode none = -1;
+
+constexpr TokenCode make(const TokenKind kind, const std::uint32_t index) {
+  return static_cast<TokenCode>(static_cast<std::uint64_t>(kind) << 32 |
+                                index);
+}
+constexpr TokenKind kind(const TokenCode code) {
+  return static_cast<TokenKind>(static_cast<std::uint64_t>(code) >> 32);
+}
+constexpr std::uint32_t index(const TokenCode code) {
+  return static_cast<std::uint32_t>(code);
+}
+/// The code is a valid code of the kind
+constexpr bool is(const TokenCode code, const TokenKind of) {
+  return code >= 0 && kind(code) == of;
+}
+
+/// Letters that tag the printed codes, by kind
+constexpr char tags[] = {'\0', 'C', 'I', 'E'};
+constexpr std::size_t tag_count = sizeof(tags);
+
+/// Printed form: the plain number of a predefined code, otherwise the
+/// kind's letter and the index, e.g. C0, I12, E3
+inline std::string to_string(const TokenCode code) {
+  const auto tag = static_cast<std::size_t>(kind(code));
+  if (code < 0 || tag == 0 || tag >= tag_count) {
+    return std::to_string(code);
+  }
+  return tags[tag] + std::to_string(index(code));
+}
+
+/// Read a printed code. Plain numbers from lexers that still used fixed
+/// bands are read too: constants from 501, identifiers from 1000 and
+/// emails from 2000. Returns false if text is no code.
+inline bool parse(std::string_view text, TokenCode& code) {
+  std::size_t tag = 0;
+  if (!text.empty()) {
+    for (std::size_t i = 1; i < tag_count; ++i) {
+      if (text[0] == tags[i]) {
+        tag = i;
+        text.remove_prefix(1);
+        break;
+      }
+    }
+  }
+  if (tag == 0 && text == "-1") {
+    code = none;
+    return true;
+  }
+  if (text.empty() || text.size() > 10) {
+    return false;
+  }
+  std::uint64_t value = 0;
+  for (char c : text) {
+    if (c < '0' || c > '9') {
+      return false;
+    }
+    value = value * 10 + static_cast<std::uint64_t>(c - '0');
+  }
+  if (value > 0xFFFFFFFF) {
+    return false;
+  }
+  if (tag != 0) {
+    code = make(static_cast<TokenKind>(tag),
+                static_cast<std::uint32_t>(value));
+  } else if (value <= 500) {
+    code = make(TokenKind::Predefined, static_cast<std::uint32_t>(value));
+  } else if (value < 1000) {
+    code = make(TokenKind::Constant, static_cast<std::uint32_t>(value - 501));
+  } else if (value < 2000) {
+    code = make(TokenKind::Identifier,
+                static_cast<std::uint32_t>(value - 1000));
+  } else {
+    code = make(TokenKind::Email, static_cast<std::uint32_t>(value - 2000));
+  }
+  return true;
+}
+}  // namespace token_code
+}  // namespace translator
@@ -0,0 +1,99 @@
+/* UTF-8 validation of source text */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "lexer_scan.h"
+
+namespace translator {
+namespace utf8 {
+
+/// Bytes of the valid UTF-8 char starting at p, 1 for ASCII; 0 if the
+/// bytes there are no valid char: a stray continuation byte, a truncated
+/// sequence, an overlong form, a surrogate or a code point past U+10FFFF
+inline std::size_t sequence_length(const char* p, const char* end) {
+  const auto lead = static_cast<unsigned char>(*p);
+  if (lead < 0x80) {
+    return 1;
+  }
+  std::size_t size;
+  // bounds of the second byte, which also rule out overlong forms,
+  // surrogates and code points past U+10FFFF
+  unsigned char low = 0x80;
+  unsigned char high = 0xBF;
+  if (lead < 0xC2) {
+    return 0;
+  } else if (lead < 0xE0) {
+    size = 2;
+  } else if (lead < 0xF0) {
+    size = 3;
+    if (lead == 0xE0) {
+      low = 0xA0;
+    } else if (lead == 0xED) {
+      high = 0x9F;
+    }
+  } else if (lead < 0xF5) {
+    size = 4;
+    if (lead == 0xF0) {
+      low = 0x90;
+    } else if (lead == 0xF4) {
+      high = 0x8F;
+    }
+  } else {
+    return 0;
+  }
+  if (static_cast<std::size_t>(end - p) < size) {
+    return 0;
+  }
+  const auto second = static_cast<unsigned char>(p[1]);
+  if (second < low || second > high) {
+    return 0;
+  }
+  for (std::size_t i = 2; i < size; ++i) {
+    if (!scan::is_continuation(p[i])) {
+      return 0;
+    }
+  }
+  return size;
+}
+
+/// Whether a short range is all ASCII, 8 bytes at a time
+inline bool all_ascii(const char* p, const char* end) {
+  std::uint64_t bits = 0;
+  for (; end - p >= 8; p += 8) {
+    std::uint64_t word;
+    std::memcpy(&word, p, 8);
+    bits |= word;
+  }
+  for (; p != end; ++p) {
+    bits |= static_cast<unsigned char>(*p);
+  }
+  return (bits & 0x8080808080808080ull) == 0;
+}
+
+/// First byte of [p, end) that isn't part of a valid UTF-8 char, or end.
+/// ASCII runs are skipped a vector at a time, short ranges a word at a
+/// time; only the chars past them are decoded.
+inline const char* find_invalid(const char* p,
+                                const char* end,
+                                const scan::Kernels& kernels = scan::kernels()) {
+  if (end - p < 64 && all_ascii(p, end)) {
+    return end;
+  }
+  for (;;) {
+    p = kernels.skip_ascii(p, end);
+    if (p == end) {
+      return end;
+    }
+    // decode up to the next ASCII byte
+    do {
+      const std::size_t size = sequence_length(p, end);
+      if (size == 0) {
+        return p;
+      }
+      p += size;
+    } while (p != end && !scan::is_ascii(*p));
+  }
+}
+}  // namespace utf8
+}  // namespace translator
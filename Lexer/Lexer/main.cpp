@@ -29,39 +29,230 @@
  --c
  <email> --> <identifier>@<string>.<string>
 */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
 #include <cstring>
+#include <filesystem>
 #include <iomanip>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <sstream>
 #include <string>
+#include <vector>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+#include "lexem_file.h"
 #include "lexer.h"
 #include "predefined_lexem.h"
 #include "print_helpers.h"
+#include "work_stealing_pool.h"
 
 using namespace translator;
+namespace fs = std::filesystem;
 
 #define STREQ(a, b) (strcmp((a), (b)) == 0)
 #define INVALID_KEY 100
 #define NO_INPUT 101
+#define UNREAD_INPUT 102
 #define KEYERROR(keystr, reason)                                             \
   std::cout << "Wrong use of key " << keystr << ": " << reason << std::endl; \
   return INVALID_KEY;
 
-inline void print_results(LexemData &results, std::ostream &output = std::cout) {
-  output.width(7);
-  output << "~~Lexem list\n";
-  fixed_width_print_line({ ":name", ":id", ":row", ":column" }, 15, output);
-  for (auto& x : results.tokens) {
-    fixed_width_print_line({ x.name, std::to_string(x.symbol),
-      std::to_string(x.row), std::to_string(x.column) },
-      15, output);
-  }
-  output << "~~Lexem table\n";
-  results.lexem_codes.print(output);
+/// Shell-style match with '*' and '?'
+bool wildcard_match(const char* pattern, const char* name) {
+  const char* star = nullptr;
+  const char* resume = nullptr;
+  while (*name) {
+    if (*pattern == '?' || *pattern == *name) {
+      ++pattern;
+      ++name;
+    } else if (*pattern == '*') {
+      star = pattern++;
+      resume = name;
+    } else if (star) {
+      pattern = star + 1;
+      name = ++resume;
+    } else {
+      return false;
+    }
+  }
+  while (*pattern == '*') {
+    ++pattern;
+  }
+  return *pattern == '\0';
+}
+
+bool is_glob(const std::string& s) {
+  return s.find_first_of("*?") != std::string::npos;
+}
+
+/// Files matching a pattern; only the file name part may have wildcards
+std::vector<std::string> expand_glob(const std::string& pattern) {
+  std::vector<std::string> files;
+  fs::path path(pattern);
+  fs::path dir = path.has_parent_path() ? path.parent_path() : fs::path(".");
+  std::string name_pattern = path.filename().string();
+  std::error_code error;
+  for (const auto& x : fs::directory_iterator(dir, error)) {
+    if (x.is_regular_file(error) &&
+        wildcard_match(name_pattern.c_str(),
+                       x.path().filename().string().c_str())) {
+      files.push_back(path.has_parent_path() ? x.path().string()
+                                             : x.path().filename().string());
+    }
+  }
+  std::sort(files.begin(), files.end());
+  return files;
+}
+
+/// Regular files under a directory, recursively
+std::vector<std::string> list_directory(const std::string& dir) {
+  std::vector<std::string> files;
+  std::error_code error;
+  for (const auto& x : fs::recursive_directory_iterator(dir, error)) {
+    if (x.is_regular_file(error)) {
+      files.push_back(x.path().string());
+    }
+  }
+  std::sort(files.begin(), files.end());
+  return files;
+}
+
+/// Paths listed one per line; empty lines are skipped
+std::vector<std::string> read_list(const std::string& list_file) {
+  std::vector<std::string> files;
+  std::ifstream list(list_file);
+  std::string line;
+  while (std::getline(list, line)) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    if (!line.empty()) {
+      files.push_back(line);
+    }
+  }
+  return files;
+}
+
+/// Write results as printed tables or in the binary format
+void write_results(const LexemData& results,
+                   const std::string& output_file_name,
+                   const bool binary) {
+  if (binary) {
+    std::ofstream output(output_file_name, std::ios::binary);
+    write_lexem_file(results, output);
+  } else {
+    std::ofstream output(output_file_name);
+    print_results(results, output);
+  }
+}
+
+/// Default output file: "lexer_" + input, plus ".bin" for binary output
+std::string default_output_name(const std::string& input, const bool binary) {
+  return "lexer_" + input + (binary ? ".bin" : "");
+}
+
+/// Output file of one input in batch mode, next to the input or in
+/// output_dir
+std::string batch_output_name(const std::string& input,
+                              const std::string& output_dir,
+                              const bool binary) {
+  fs::path path(input);
+  fs::path dir = output_dir.empty() ? path.parent_path() : fs::path(output_dir);
+  return (dir / default_output_name(path.filename().string(), binary))
+      .string();
+}
+
+/// Lex many files on a work-stealing pool, largest first.
+/// Returns the number of files that couldn't be read.
+int run_batch(const std::vector<std::string>& inputs,
+              const std::string& output_dir,
+              const unsigned threads,
+              const bool use_std_cout,
+              const bool binary,
+              const DiagnosticLimits& limits,
+              const bool shared_codes) {
+  std::vector<std::uintmax_t> sizes(inputs.size());
+  for (std::size_t i = 0; i < inputs.size(); ++i) {
+    std::error_code error;
+    sizes[i] = fs::file_size(inputs[i], error);
+    if (error) {
+      sizes[i] = 0;
+    }
+  }
+  std::vector<std::size_t> order(inputs.size());
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [&](std::size_t a, std::size_t b) { return sizes[a] > sizes[b]; });
+  if (!output_dir.empty()) {
+    std::error_code error;
+    fs::create_directories(output_dir, error);
+  }
+
+  WorkStealingPool pool(threads);
+  std::vector<Lexer> lexers(pool.threads());
+  auto intern = shared_codes ? std::make_shared<InternTable>() : nullptr;
+  for (auto& x : lexers) {
+    x.set_intern_table(intern);
+  }
+  std::mutex output_lock;
+  std::atomic<std::uintmax_t> total_bytes(0);
+  std::atomic<std::size_t> total_tokens(0);
+  std::atomic<int> failed(0);
+  auto started = std::chrono::steady_clock::now();
+  pool.run(order, [&](std::size_t job, unsigned thread) {
+    const std::string& input = inputs[job];
+    std::ostringstream errors;
+    Lexer& lx = lexers[thread];
+    lx.set_error_output(errors);
+    lx.set_diagnostic_limits(limits);
+    LexerAutomaton* automaton = lx.open(input);
+    if (automaton == nullptr) {
+      ++failed;
+    } else {
+      auto results = automaton->run();
+      write_results(results, batch_output_name(input, output_dir, binary),
+                    binary);
+      total_bytes += sizes[job];
+      total_tokens += results.tokens.size();
+      if (use_std_cout) {
+        std::lock_guard<std::mutex> guard(output_lock);
+        std::cout << "~~File " << input << '\n';
+        print_results(results);
+      }
+    }
+    if (errors.tellp() > 0) {
+      std::lock_guard<std::mutex> guard(output_lock);
+      std::cout << "~~Errors in " << input << '\n' << errors.str();
+    }
+  });
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - started)
+                       .count();
+  double megabytes = static_cast<double>(total_bytes) / 1e6;
+  std::cout << "~~Batch: " << inputs.size() - failed << " files, "
+            << megabytes << " MB, " << total_tokens << " tokens in "
+            << seconds << " s on " << pool.threads() << " threads: "
+            << megabytes / seconds << " MB/s, "
+            << static_cast<double>(total_tokens) / seconds << " tokens/s\n";
+  if (intern != nullptr) {
+    std::cout << "~~Shared codes: " << intern->size() << " names\n";
+  }
+  if (failed > 0) {
+    std::cout << "~~Failed: " << failed << " files\n";
+  }
+  return failed;
 }
 
 int main(int argc, char* argv[]) {
-  Lexer lx(predefined_lexem);
+  Lexer lx(predefined_lexem());
   std::string input_file_name;
   std::string output_file_name;
 
@@ -72,15 +263,31 @@ int main(int argc, char* argv[]) {
       help            - prints help(--help)\
       -f filename_in  - file to parse(--file)\
       -o filename_out - file to output(--output).Default is \"lexer_\" + filename_in \
-      -v              - output to command line(--verbose)";
+      -v              - output to command line(--verbose)\
+      -j threads      - lex the file on several threads(--jobs), 0 for all cores\
+      -b              - binary output for the parser(--binary). Default output is \"lexer_\" + filename_in + \".bin\"\
+      -e count        - lexer errors to print at most(--errors), 1000 by default\
+    stream mode (input of any length in little memory):\
+      -f -            - read standard input as it comes; the tables go to -o or, by default, to standard output and errors to standard error\
+    batch mode (many files; -o names an output directory, -j the pool size):\
+      -f pattern      - files matching a '*'/'?' pattern\
+      -d directory    - all files in a directory, recursively(--dir)\
+      -l list_file    - files listed one per line(--list)\
+      -s              - one code per name across all the files(--shared-codes); codes then depend on the order files are lexed in";
     return 0;
   }
   //parse rest
   std::string* pending = nullptr;
   bool use_std_cout = false;
+  bool binary = false;
+  bool shared_codes = false;
+  std::string jobs;
+  std::string max_errors;
+  std::string input_dir;
+  std::string input_list;
   for (int i = 1; i < argc; ++i) {
-    // if it's a key
-    if (*(argv[i]) == '-') {
+    // if it's a key; a lone '-' is standard input
+    if (*(argv[i]) == '-' && argv[i][1] != '\0') {
       if (pending) {
         // no file specified for the previous key
         // safe because 'pending' is set only after key
@@ -92,6 +299,18 @@ int main(int argc, char* argv[]) {
         pending = &output_file_name;
       } else if (STREQ(argv[i], "-v") || STREQ(argv[i], "--verbose")) {
         use_std_cout = true;
+      } else if (STREQ(argv[i], "-b") || STREQ(argv[i], "--binary")) {
+        binary = true;
+      } else if (STREQ(argv[i], "-j") || STREQ(argv[i], "--jobs")) {
+        pending = &jobs;
+      } else if (STREQ(argv[i], "-e") || STREQ(argv[i], "--errors")) {
+        pending = &max_errors;
+      } else if (STREQ(argv[i], "-d") || STREQ(argv[i], "--dir")) {
+        pending = &input_dir;
+      } else if (STREQ(argv[i], "-l") || STREQ(argv[i], "--list")) {
+        pending = &input_list;
+      } else if (STREQ(argv[i], "-s") || STREQ(argv[i], "--shared-codes")) {
+        shared_codes = true;
       } else {
         KEYERROR(argv[i], "Invalid key!")
       }
@@ -109,21 +328,89 @@ int main(int argc, char* argv[]) {
   if (pending) {
     KEYERROR(argv[argc - 1], "No argument specified!")
   }
-  if (input_file_name.empty()) {
+  const bool batch =
+      !input_dir.empty() || !input_list.empty() || is_glob(input_file_name);
+  if (input_file_name.empty() && !batch) {
     std::cout << "No input specified!\n";
     return NO_INPUT;
   }
+  if (shared_codes && !batch) {
+    KEYERROR("-s", "Shared codes need many files!")
+  }
+  int threads = batch ? 0 : 1;
+  if (!jobs.empty()) {
+    char* jobs_end = nullptr;
+    threads = static_cast<int>(std::strtol(jobs.c_str(), &jobs_end, 10));
+    if (*jobs_end != '\0' || threads < 0) {
+      KEYERROR("-j", "Invalid number of threads!")
+    }
+  }
+  DiagnosticLimits limits;
+  if (!max_errors.empty()) {
+    char* errors_end = nullptr;
+    long count = std::strtol(max_errors.c_str(), &errors_end, 10);
+    if (*errors_end != '\0' || count < 0) {
+      KEYERROR("-e", "Invalid number of errors!")
+    }
+    limits.max_kept = static_cast<std::size_t>(count);
+  }
+  lx.set_diagnostic_limits(limits);
+  if (batch) {
+    std::vector<std::string> inputs;
+    if (is_glob(input_file_name)) {
+      inputs = expand_glob(input_file_name);
+    } else if (!input_file_name.empty()) {
+      inputs.push_back(input_file_name);
+    }
+    if (!input_dir.empty()) {
+      auto files = list_directory(input_dir);
+      inputs.insert(inputs.end(), files.begin(), files.end());
+    }
+    if (!input_list.empty()) {
+      auto files = read_list(input_list);
+      inputs.insert(inputs.end(), files.begin(), files.end());
+    }
+    if (inputs.empty()) {
+      std::cout << "No input specified!\n";
+      return NO_INPUT;
+    }
+    if (run_batch(inputs, output_file_name, static_cast<unsigned>(threads),
+                  use_std_cout, binary, limits, shared_codes) > 0) {
+      return UNREAD_INPUT;
+    }
+    return 0;
+  }
+  // lex standard input as it comes
+  if (input_file_name == "-") {
+    if (binary) {
+      KEYERROR("-b", "Binary output needs the whole input!")
+    }
+    if (threads != 1) {
+      KEYERROR("-j", "Standard input is lexed on one thread!")
+    }
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+#endif
+    std::ios::sync_with_stdio(false);
+    if (output_file_name.empty() || output_file_name == "-") {
+      lx.set_error_output(std::cerr);
+      lx.run_stream(std::cin, std::cout);
+    } else {
+      std::ofstream output(output_file_name);
+      lx.run_stream(std::cin, output);
+    }
+    return 0;
+  }
   // parse file
-  auto results = lx(input_file_name);
-  std::shared_ptr<std::ostream> output;
+  auto results = (threads == 1) ? lx(input_file_name)
+                                : lx.run_parallel(input_file_name, threads);
   if (output_file_name.empty()) {
-    output_file_name = "lexer_" + input_file_name;
-  } 
-  output = std::make_shared<std::ofstream>(output_file_name.c_str());
+    output_file_name = default_output_name(input_file_name, binary);
+  }
 
   if (use_std_cout) {
     print_results(results);
   }
-  print_results(results, *output);
+  write_results(results, output_file_name, binary);
   return 0;
 }
\ No newline at end of file
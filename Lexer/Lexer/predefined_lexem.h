@@ -1,12 +1,125 @@
 /* Predefined lexem */
 
 #pragma once
+#include <array>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
 #include "lexer_property_container.h"
 
-translator::PropertyContainer predefined_lexem(
-    std::unordered_map<std::string, int>{
-        {";", int(';')}, {".", int('.')}, {"<", int('<')}, {">", int('>')},
-        {"=", int('=')},  {"[", int('[')}, {"]", int(']')}, {":", int(':')},
-        {":=", 301},      {"<=", 302},     {">=", 303},     {"<>", 304},
-        {"PROGRAM", 401}, {"BEGIN", 402},  {"END", 403},    {"VAR", 404},
-        {"OR", 405},      {"AND", 406},    {"NOT", 407},    {"INTEGER", 408}});
\ No newline at end of file
+namespace translator {
+
+/// Reserved word or delimiter with its fixed code
+struct PredefinedLexem {
+  const char* lexem;
+  std::size_t size;
+  int code;
+};
+
+constexpr PredefinedLexem predefined_lexem_table[] = {
+    {";", 1, int(';')},   {".", 1, int('.')},   {"<", 1, int('<')},
+    {">", 1, int('>')},   {"=", 1, int('=')},   {"[", 1, int('[')},
+    {"]", 1, int(']')},   {":", 1, int(':')},   {":=", 2, 301},
+    {"<=", 2, 302},       {">=", 2, 303},       {"<>", 2, 304},
+    {"PROGRAM", 7, 401},  {"BEGIN", 5, 402},    {"END", 3, 403},
+    {"VAR", 3, 404},      {"OR", 2, 405},       {"AND", 3, 406},
+    {"NOT", 3, 407},      {"INTEGER", 7, 408}};
+
+constexpr std::size_t predefined_lexem_count =
+    sizeof(predefined_lexem_table) / sizeof(predefined_lexem_table[0]);
+
+namespace predefined_hash {
+
+constexpr std::size_t slot_count = 64;
+constexpr unsigned char empty_slot = 0xFF;
+
+/// ASCII upper case; everything else is left as is
+constexpr unsigned char fold(char c) {
+  return static_cast<unsigned char>((c >= 'a' && c <= 'z') ? c - 'a' + 'A'
+                                                            : c);
+}
+
+/// Hash of the length and the first and last chars, case-insensitive
+constexpr std::size_t hash(const char* s, std::size_t n, unsigned seed) {
+  return (n * 31u + fold(s[0]) * seed + fold(s[n - 1]) * (seed >> 4)) &
+         (slot_count - 1);
+}
+
+constexpr bool is_perfect(unsigned seed) {
+  bool used[slot_count] = {};
+  for (const auto& x : predefined_lexem_table) {
+    auto h = hash(x.lexem, x.size, seed);
+    if (used[h]) {
+      return false;
+    }
+    used[h] = true;
+  }
+  return true;
+}
+
+constexpr unsigned find_seed() {
+  for (unsigned seed = 1; seed < (1u << 16); ++seed) {
+    if (is_perfect(seed)) {
+      return seed;
+    }
+  }
+  return 0;
+}
+
+constexpr unsigned seed = find_seed();
+static_assert(seed != 0, "no perfect hash seed for predefined lexems");
+
+constexpr std::array<unsigned char, slot_count> build_slots() {
+  std::array<unsigned char, slot_count> slots{};
+  for (auto& x : slots) {
+    x = empty_slot;
+  }
+  for (std::size_t i = 0; i < predefined_lexem_count; ++i) {
+    const auto& x = predefined_lexem_table[i];
+    slots[hash(x.lexem, x.size, seed)] = static_cast<unsigned char>(i);
+  }
+  return slots;
+}
+
+constexpr std::array<unsigned char, slot_count> slots = build_slots();
+}  // namespace predefined_hash
+
+/// Find a reserved word or delimiter, ignoring ASCII case.
+/// Returns nullptr if s isn't predefined.
+inline const PredefinedLexem* find_predefined(const char* s, std::size_t n) {
+  if (n == 0) {
+    return nullptr;
+  }
+  auto i = predefined_hash::slots[predefined_hash::hash(s, n, predefined_hash::seed)];
+  if (i == predefined_hash::empty_slot) {
+    return nullptr;
+  }
+  const auto& x = predefined_lexem_table[i];
+  if (x.size != n) {
+    return nullptr;
+  }
+  for (std::size_t j = 0; j < n; ++j) {
+    if (predefined_hash::fold(s[j]) != static_cast<unsigned char>(x.lexem[j])) {
+      return nullptr;
+    }
+  }
+  return &x;
+}
+
+inline const PredefinedLexem* find_predefined(const std::string& s) {
+  return find_predefined(s.data(), s.size());
+}
+
+/// Code table with all predefined lexems.
+/// Built on first use, not at static-init time.
+inline const PropertyContainer& predefined_lexem() {
+  static const PropertyContainer table = [] {
+    std::unordered_map<std::string, int> map;
+    for (const auto& x : predefined_lexem_table) {
+      map.emplace(std::string(x.lexem, x.size), x.code);
+    }
+    return PropertyContainer(map);
+  }();
+  return table;
+}
+}  // namespace translator
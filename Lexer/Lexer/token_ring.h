@@ -0,0 +1,110 @@
+/* Bounded single-producer single-consumer token queue */
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+#include "lexer_data.h"
+
+namespace translator {
+
+/// Hands tokens from one thread to another through a fixed ring of slots,
+/// so a consumer can start on the first tokens while the producer is
+/// still making the rest, and no more tokens than slots are ever held.
+/// One thread pushes and one other thread pops; neither takes a lock.
+/// Each side owns one index and keeps a stale copy of the other's, which
+/// it reloads only when the ring looks full or empty. Slots keep their
+/// name strings, so once the ring has gone round names are copied without
+/// allocating. A side that has to wait spins briefly, then yields.
+class TokenRing {
+ public:
+  /// capacity is rounded up to a power of 2
+  explicit TokenRing(const std::size_t capacity = 4096) {
+    std::size_t size = 2;
+    while (size < capacity) {
+      size *= 2;
+    }
+    m_slots.resize(size);
+    m_mask = size - 1;
+  }
+  TokenRing(const TokenRing&) = delete;
+  TokenRing& operator=(const TokenRing&) = delete;
+
+  std::size_t capacity() const { return m_slots.size(); }
+
+  /// Copy a token in, waiting while the ring is full. Producer only.
+  /// Returns false and drops the token once the consumer has left.
+  bool push(const LexemToken& token) {
+    const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+    for (unsigned spins = 0; tail - m_head_seen == m_slots.size();) {
+      m_head_seen = m_head.load(std::memory_order_acquire);
+      if (tail - m_head_seen != m_slots.size()) {
+        break;
+      }
+      if (m_left.load(std::memory_order_acquire)) {
+        return false;
+      }
+      wait(spins);
+    }
+    LexemToken& slot = m_slots[tail & m_mask];
+    slot.symbol = token.symbol;
+    slot.name.assign(token.name);
+    slot.row = token.row;
+    slot.column = token.column;
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// No more tokens will be pushed. Producer only.
+  void close() { m_closed.store(true, std::memory_order_release); }
+
+  /// Take the next token, waiting while the ring is empty. Consumer only.
+  /// Returns false once the ring is closed and every token taken.
+  bool pop(LexemToken& token) {
+    const std::size_t head = m_head.load(std::memory_order_relaxed);
+    for (unsigned spins = 0; head == m_tail_seen;) {
+      m_tail_seen = m_tail.load(std::memory_order_acquire);
+      if (head != m_tail_seen) {
+        break;
+      }
+      if (m_closed.load(std::memory_order_acquire)) {
+        // the last pushes are visible once the close is
+        m_tail_seen = m_tail.load(std::memory_order_acquire);
+        if (head == m_tail_seen) {
+          return false;
+        }
+        break;
+      }
+      wait(spins);
+    }
+    LexemToken& slot = m_slots[head & m_mask];
+    token.symbol = slot.symbol;
+    token.name.swap(slot.name);
+    token.row = slot.row;
+    token.column = slot.column;
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// Stop taking tokens; pushes fail once the ring fills. Consumer only.
+  void leave() { m_left.store(true, std::memory_order_release); }
+
+ private:
+  static void wait(unsigned& spins) {
+    if (++spins > 64) {
+      std::this_thread::yield();
+    }
+  }
+
+  std::vector<LexemToken> m_slots;
+  std::size_t m_mask = 0;
+  // the consumer's side
+  alignas(64) std::atomic<std::size_t> m_head{0};
+  std::size_t m_tail_seen = 0;
+  // the producer's side
+  alignas(64) std::atomic<std::size_t> m_tail{0};
+  std::size_t m_head_seen = 0;
+  alignas(64) std::atomic<bool> m_closed{false};
+  std::atomic<bool> m_left{false};
+};
+}  // namespace translator
@@ -0,0 +1,80 @@
+/* Work-stealing thread pool */
+#pragma once
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace translator {
+
+/// Runs a fixed set of jobs on several threads.
+/// Jobs are dealt round-robin to per-thread deques in the given order.
+/// A thread takes jobs from the front of its own deque and, once it is
+/// empty, steals from the back of the others, so the jobs dealt first
+/// (e.g. the largest ones) start first and stragglers get balanced.
+class WorkStealingPool {
+ public:
+  explicit WorkStealingPool(unsigned threads = 0)
+      : m_threads(threads != 0 ? threads : std::thread::hardware_concurrency()) {
+    if (m_threads == 0) {
+      m_threads = 1;
+    }
+  }
+
+  unsigned threads() const { return m_threads; }
+
+  /// Call f(job, thread_index) once for every job in order
+  template <class F>
+  void run(const std::vector<std::size_t>& order, F f) {
+    std::vector<Queue> queues(m_threads);
+    for (std::size_t i = 0; i < order.size(); ++i) {
+      queues[i % m_threads].jobs.push_back(order[i]);
+    }
+    auto worker = [&](unsigned self) {
+      std::size_t job;
+      while (take(queues, self, job)) {
+        f(job, self);
+      }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < m_threads; ++i) {
+      pool.emplace_back(worker, i);
+    }
+    worker(0);
+    for (auto& x : pool) {
+      x.join();
+    }
+  }
+
+ private:
+  struct Queue {
+    std::mutex lock;
+    std::deque<std::size_t> jobs;
+  };
+
+  /// Next job for a thread: its own first, then one stolen from the others
+  bool take(std::vector<Queue>& queues, unsigned self, std::size_t& job) {
+    {
+      std::lock_guard<std::mutex> guard(queues[self].lock);
+      if (!queues[self].jobs.empty()) {
+        job = queues[self].jobs.front();
+        queues[self].jobs.pop_front();
+        return true;
+      }
+    }
+    for (unsigned i = 1; i < m_threads; ++i) {
+      Queue& victim = queues[(self + i) % m_threads];
+      std::lock_guard<std::mutex> guard(victim.lock);
+      if (!victim.jobs.empty()) {
+        job = victim.jobs.back();
+        victim.jobs.pop_back();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  unsigned m_threads;
+};
+}  // namespace translator
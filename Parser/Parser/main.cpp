@@ -55,7 +55,7 @@ int main(int argc, char* argv[]) {
   if (argc == 2 && STREQ(argv[1], "help")) {
     std::cout << "supported args:\
       help            - prints help(--help)\
-      -f filename_in  - file to parse(--file)\
+      -f filename_in  - file to parse(--file), printed or binary lexer output\
       -o filename_out - file to output(--output).Default is \"parser_\" + filename_in \
       -v              - output to command line(--verbose)";
     return 0;
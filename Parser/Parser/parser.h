@@ -2,45 +2,101 @@
 #include <exception>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <stack>
 #include <string>
+#include <utility>
 #include "lexer_data.h"
 #include "parser_containers.h"
+#include "token_ring.h"
 
 namespace translator {
 struct ParserResult {
   ParserTree syntax;
-  PropertyContainer identifiers;
+  // code table of the parsed tokens, shared with them
+  std::shared_ptr<const PropertyContainer> identifiers;
 };
 
+/// Recursive descent parser. It looks at one token at a time, the one at
+/// _pos, taken either from lexer results held in memory or pulled one by
+/// one from a source such as a TokenRing a lexer fills on another thread
+/// or a coroutine lexing on demand. Past the last token it sees a token
+/// with code -1 and no name.
 class Parser {
-  LexemData _data;
-  int _pos;
+  // tokens held in memory, if they aren't pulled
+  std::shared_ptr<const LexemData> _data;
+  // source the tokens are pulled from while parse_pulled() runs
+  using Pull = bool (*)(void* source, LexemToken& token);
+  Pull _pull = nullptr;
+  void* _source = nullptr;
+  // codes the grammar's lexems are looked up in
+  const PropertyContainer* _codes;
+  std::size_t _pos;
+  // the token at _pos when it is pulled or past the end
+  LexemToken _token;
+  bool _end = false;
   ParserResult _res;
+  std::ostream* _error_output = &std::cout;
 
-  inline LexemToken token_at(int pos) { return _data.tokens[pos]; }
+  inline bool at_end() const {
+    return _pull != nullptr ? _end : _pos >= _data->tokens.size();
+  }
+  inline LexemToken token() const {
+    if (_pull != nullptr || at_end()) {
+      return _token;
+    }
+    return _data->tokens[_pos];
+  }
+  inline TokenCode symbol() const {
+    return _pull != nullptr || at_end() ? _token.symbol
+                                        : _data->tokens.symbol(_pos);
+  }
+  inline const std::string& name() const {
+    return _pull != nullptr || at_end() ? _token.name
+                                        : _data->tokens.name(_pos);
+  }
 
-  inline auto symbol_at(int pos) const { return _data.tokens[pos].symbol; }
-  inline auto name_at(int pos) const { return _data.tokens[pos].name; }
+  /// Move to the next token
+  void advance() {
+    ++_pos;
+    if (_pull != nullptr) {
+      if (!_pull(_source, _token)) {
+        end_token();
+      }
+    } else if (at_end()) {
+      end_token();
+    }
+  }
+  /// Past the last token: no code or name, at the last token's position
+  void end_token() {
+    if (_pull == nullptr && _pos > 0 && _pos <= _data->tokens.size()) {
+      LexemTokenRef last = _data->tokens[_pos - 1];
+      _token.row = last.row;
+      _token.column = last.column;
+    }
+    _token.symbol = token_code::none;
+    _token.name.clear();
+    _end = true;
+  }
 
   inline bool previous_empty() const {
     return (_res.syntax._lastAdded->type == ParserTokenType::Empty);
   }
 #define SYNTAX_EXCEPTION(s)                                              \
-  std::cout << '[' << token_at(_pos).row << ':' << token_at(_pos).column \
+  *_error_output << '[' << token().row << ':' << token().column          \
             << ']' << std::setw(25) << "Syntax error: Expected \'" << s  \
-            << "\', got \'" << name_at(_pos) << "\'("              \
-            << symbol_at(_pos) << ")\n";                           \
+            << "\', got \'" << name() << "\'("              \
+            << token_code::to_string(symbol()) << ")\n";    \
   result = false;
 
-#define FIND_COMPARE_SYMBOL(c) (_data.lexem_codes[c] == symbol_at(_pos))
+#define FIND_COMPARE_SYMBOL(c) ((*_codes)[c] == symbol())
 
 #define INCPOS                         \
-  if (_pos >= _data.tokens.size()) {   \
+  if (at_end()) {                      \
     SYNTAX_EXCEPTION("Out of bounds"); \
     return false;                      \
   } else {                             \
-    ++_pos;                            \
+    advance();                         \
   }
 
   bool Empty() {
@@ -196,7 +252,7 @@ class Parser {
     bool result = true;
     pParserTreeNodeWeak node = _res.syntax.add(PARSER_NOVALUE, ParserTokenType::Logical);
     if (FIND_COMPARE_SYMBOL("OR")) {
-      node.lock()->value.add(token_at(_pos));
+      node.lock()->value.add(token());
       INCPOS;
       result = LogicalSummand();
       result = Logical();
@@ -221,7 +277,7 @@ class Parser {
     bool result = true;
     pParserTreeNodeWeak node = _res.syntax.add(PARSER_NOVALUE, ParserTokenType::LogicalMultipliersList);
     if (FIND_COMPARE_SYMBOL("AND")) {
-      node.lock()->value.add(token_at(_pos));
+      node.lock()->value.add(token());
       INCPOS;
       result = LogicalMultiplier();
       if (result) {
@@ -238,18 +294,18 @@ class Parser {
     bool result = true;
     pParserTreeNodeWeak node = _res.syntax.add(PARSER_NOVALUE, ParserTokenType::LogicalMultiplier);
     if (FIND_COMPARE_SYMBOL("NOT")) {
-      node.lock()->value.add(token_at(_pos));
+      node.lock()->value.add(token());
       INCPOS;
       result = LogicalMultiplier();
       if (!result) {
         Empty();
       }
     } else if (FIND_COMPARE_SYMBOL("[")) {
-      node.lock()->value.add(token_at(_pos));
+      node.lock()->value.add(token());
       INCPOS;
       result = ConditionalExpression();
       if (result && FIND_COMPARE_SYMBOL("]")) {
-        node.lock()->value.add(token_at(_pos));
+        node.lock()->value.add(token());
         INCPOS;
       } else {
         SYNTAX_EXCEPTION("]");
@@ -279,7 +335,7 @@ class Parser {
     if (FIND_COMPARE_SYMBOL(">") || FIND_COMPARE_SYMBOL("<") ||
         FIND_COMPARE_SYMBOL("=") || FIND_COMPARE_SYMBOL(">=") ||
         FIND_COMPARE_SYMBOL("<=") || FIND_COMPARE_SYMBOL("<>")) {
-      node.lock()->value.add(token_at(_pos));
+      node.lock()->value.add(token());
       INCPOS;
     } else {
       Empty();
@@ -319,12 +375,12 @@ class Parser {
   bool Identifier() {
     bool result = true;
     pParserTreeNodeWeak node = _res.syntax.add(PARSER_NOVALUE, ParserTokenType::Identifier);
-    if (symbol_at(_pos) < 1000) {
+    if (!token_code::is(symbol(), TokenKind::Identifier)) {
       Empty();
       _res.syntax.headup();
       return false;
     }
-    node.lock()->value.add(token_at(_pos));
+    node.lock()->value.add(token());
     _res.syntax.headup();
     INCPOS;
     return result;
@@ -332,23 +388,77 @@ class Parser {
   bool UnsignedInteger() {
     bool result = true;
     pParserTreeNodeWeak node = _res.syntax.add(PARSER_NOVALUE, ParserTokenType::UnsignedInteger);
-    if (symbol_at(_pos) < 500 || symbol_at(_pos) >= 1000) {
+    if (!token_code::is(symbol(), TokenKind::Constant)) {
       Empty();
       _res.syntax.headup();
       return false;
     }
-    node.lock()->value.add(token_at(_pos));
+    node.lock()->value.add(token());
     _res.syntax.headup();
     INCPOS;
     return result;
   }
 
  public:
-  Parser(const LexemData& l) : _data(l), _pos(0) {
-    _res.identifiers = _data.lexem_codes;
+  /// Take over lexer results
+  Parser(LexemData&& l)
+      : Parser(std::make_shared<const LexemData>(std::move(l))) {}
+  /// Share lexer results with other readers
+  Parser(std::shared_ptr<const LexemData> l)
+      : _data(std::move(l)), _codes(&_data->lexem_codes), _pos(0) {
+    _res.identifiers =
+        std::shared_ptr<const PropertyContainer>(_data, &_data->lexem_codes);
+    if (at_end()) {
+      end_token();
+    }
   }
+  /// Parse pulled tokens, e.g. with parse(ring); codes must hold at
+  /// least the predefined lexems, and are the result's identifiers
+  Parser(std::shared_ptr<const PropertyContainer> codes)
+      : _codes(codes.get()), _pos(0) {
+    _res.identifiers = std::move(codes);
+  }
+
+  /// Syntax errors are printed to, std::cout by default
+  void set_error_output(std::ostream& output) { _error_output = &output; }
 
-  bool parse() { return SignalProgram(); }
+  /// Parse the tokens held in memory; a parser made from codes alone
+  /// holds none and only parses pulled tokens
+  bool parse() {
+    if (_data == nullptr) {
+      *_error_output << "Syntax error: no tokens in memory, parse pulled "
+                        "tokens instead\n";
+      return false;
+    }
+    return SignalProgram();
+  }
+  /// Parse tokens as they come from a ring, leaving it once the program
+  /// ends, so whatever follows is dropped as parse() ignores it
+  bool parse(TokenRing& ring) {
+    auto pop = [&ring](LexemToken& token) { return ring.pop(token); };
+    bool result = parse_pulled(pop);
+    ring.leave();
+    return result;
+  }
+  /// Parse tokens pulled one at a time with pull(token), which returns
+  /// false past the last one. No more tokens are pulled than the grammar
+  /// needs.
+  template <class Puller>
+  bool parse_pulled(Puller& pull) {
+    _pull = [](void* source, LexemToken& token) {
+      return (*static_cast<Puller*>(source))(token);
+    };
+    _source = &pull;
+    _pos = 0;
+    _end = false;
+    if (!_pull(_source, _token)) {
+      end_token();
+    }
+    bool result = SignalProgram();
+    _pull = nullptr;
+    _source = nullptr;
+    return result;
+  }
   void print(std::ostream& stream = std::cout) { _res.syntax.print(stream); }
 };
 }  // namespace translator
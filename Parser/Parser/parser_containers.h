@@ -33,8 +33,8 @@ enum class ParserTokenType {
 };
 std::ostream& operator<<(std::ostream& stream, LexemToken& rhs) {
   if (rhs.symbol > 0) {
-    stream << rhs.name << '(' << rhs.symbol << ")[" << rhs.row << ':'
-           << rhs.column << ']';
+    stream << rhs.name << '(' << token_code::to_string(rhs.symbol) << ")["
+           << rhs.row << ':' << rhs.column << ']';
   }
   return stream;
 }
@@ -114,8 +114,8 @@ using pParserTreeNodeLinks = std::vector<pParserTreeNode>;
 #define PARSER_NOVALUE ParserStatement()
 struct ParserStatement {
   std::vector<LexemToken> tokens;
-  const int row() const { return (tokens.empty()) ? -1 : tokens[0].row; }
-  const int column() const { return (tokens.empty()) ? -1 : tokens[0].column; }
+  const std::int64_t row() const { return (tokens.empty()) ? -1 : tokens[0].row; }
+  const std::int64_t column() const { return (tokens.empty()) ? -1 : tokens[0].column; }
   void add(const LexemToken& rhs) { tokens.push_back(rhs); }
   void add(const std::vector<LexemToken>& rhs) {
     tokens.reserve(tokens.size() + rhs.size());
@@ -135,7 +135,7 @@ std::ostream& operator<<(std::ostream& stream, ParserStatement& rhs) {
     stream << " #";
     // symbols
     for (auto x : rhs.tokens) {
-      stream << ' ' << x.symbol;
+      stream << ' ' << token_code::to_string(x.symbol);
     }
   }
   return stream;
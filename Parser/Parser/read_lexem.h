@@ -2,14 +2,35 @@
 #include <fstream>
 #include <iostream>
 #include <string>
+#include "lexem_file.h"
 #include "lexer_data.h"
+#include "lexer_source.h"
 
 #define FILEERROR(msg)                        \
   std::cout << "Error: " << msg << std::endl; \
-  return 0;
+  return LexemData();
 
 namespace translator {
+/// Load the binary lexer output straight from the mapped file
+LexemData load_from_binary_lexem_file(const SourceBuffer& source) {
+  LexemFileView view(source.begin(), source.end());
+  if (!view.valid()) {
+    FILEERROR(view.error())
+  }
+  LexemData m_lexem;
+  if (!view.load(m_lexem)) {
+    FILEERROR("Binary lexer output is damaged!")
+  }
+  return m_lexem;
+}
+
 LexemData load_from_lexem_file(const std::string& filename) {
+  {
+    SourceBuffer source(filename);
+    if (source.is_open() && is_lexem_file(source.begin(), source.end())) {
+      return load_from_binary_lexem_file(source);
+    }
+  }
   std::ifstream file(filename);
   LexemData m_lexem;
   // check file
@@ -32,7 +53,10 @@ LexemData load_from_lexem_file(const std::string& filename) {
     while (buf[0] != '~') {
       translator::LexemToken t;
       t.name = buf;
-      file >> t.symbol >> t.row >> t.column;
+      file >> buf >> t.row >> t.column;
+      if (!token_code::parse(buf, t.symbol)) {
+        FILEERROR("Bad token code " << buf)
+      }
       m_lexem.tokens.push_back(t);
       file >> buf;
     }
@@ -40,11 +64,15 @@ LexemData load_from_lexem_file(const std::string& filename) {
     std::getline(file, buf);
     std::getline(file, buf);
     // lexem hash second
-    while (!file.eof()) {
-      int index;
-      file >> buf >> index;
+    std::string code;
+    while (file >> buf >> code) {
+      TokenCode index;
+      if (!token_code::parse(code, index)) {
+        FILEERROR("Bad token code " << code)
+      }
       m_lexem.lexem_codes.set(buf, index);
     }
+    m_lexem.pool_constants();
 
   } catch (const std::ifstream::failure& e) {
     FILEERROR(e.what())
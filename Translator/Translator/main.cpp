@@ -0,0 +1,158 @@
+// TRANSLATOR
+// Lexer and parser for SIGNAL in one process: the lexer results are
+// handed to the parser in memory instead of through the lexer output file.
+// With -p the parser takes the tokens while the lexer is still making them;
+// with -c the lexer makes each token only when the parser asks for it.
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include "lexem_file.h"
+#include "lexer.h"
+#include "parser.h"
+#include "predefined_lexem.h"
+#include "translator_pipeline.h"
+
+#define STREQ(a, b) (strcmp((a), (b)) == 0)
+#define INVALID_KEY 100
+#define NO_INPUT 101
+#define KEYERROR(keystr, reason)                                             \
+  std::cout << "Wrong use of key " << keystr << ": " << reason << std::endl; \
+  return INVALID_KEY;
+using namespace translator;
+
+int main(int argc, char* argv[]) {
+  std::string input_file_name;
+  std::string output_file_name;
+  std::string dump_file_name;
+
+  // parse command-line args
+  // print help
+  if (argc == 2 && STREQ(argv[1], "help")) {
+    std::cout << "supported args:\
+      help            - prints help(--help)\
+      -f filename_in  - file to translate(--file)\
+      -o filename_out - file to output(--output).Default is \"parser_\" + filename_in \
+      -v              - output to command line(--verbose)\
+      -d filename     - also write the lexer output(--dump)\
+      -b              - write the lexer output in the binary format(--binary)\
+      -p              - lex on a second thread while parsing(--pipeline); tokens aren't kept, so -d can't be used\
+      -c              - lex each token when the parser needs it(--coroutine), if built as C++20; -d can't be used either";
+    return 0;
+  }
+  //parse rest
+  std::string* pending = nullptr;
+  bool use_std_cout = false;
+  bool binary = false;
+  bool pipeline = false;
+  bool coroutine = false;
+  for (int i = 1; i < argc; ++i) {
+    // if it's a key
+    if (*(argv[i]) == '-') {
+      if (pending) {
+        // no file specified for the previous key
+        // safe because 'pending' is set only after key
+        KEYERROR(argv[i - 1], "No argument specified!")
+      }
+      if (STREQ(argv[i], "-f") || STREQ(argv[i], "--file")) {
+        pending = &input_file_name;
+      } else if (STREQ(argv[i], "-o") || STREQ(argv[i], "--output")) {
+        pending = &output_file_name;
+      } else if (STREQ(argv[i], "-v") || STREQ(argv[i], "--verbose")) {
+        use_std_cout = true;
+      } else if (STREQ(argv[i], "-d") || STREQ(argv[i], "--dump")) {
+        pending = &dump_file_name;
+      } else if (STREQ(argv[i], "-b") || STREQ(argv[i], "--binary")) {
+        binary = true;
+      } else if (STREQ(argv[i], "-p") || STREQ(argv[i], "--pipeline")) {
+        pipeline = true;
+      } else if (STREQ(argv[i], "-c") || STREQ(argv[i], "--coroutine")) {
+#ifdef TRANSLATOR_COROUTINES
+        coroutine = true;
+#else
+        KEYERROR(argv[i], "Built without C++20 coroutines!")
+#endif
+      } else {
+        KEYERROR(argv[i], "Invalid key!")
+      }
+    } else {
+      if (pending) {
+        // write an argument
+        *pending = argv[i];
+        pending = nullptr;
+      } else {
+        // no key
+        KEYERROR(argv[i], "Invalid key!")
+      }
+    }
+  }
+  if (pending) {
+    KEYERROR(argv[argc - 1], "No argument specified!")
+  }
+  if (input_file_name.empty()) {
+    std::cout << "No input specified!\n";
+    return NO_INPUT;
+  }
+  if (binary && dump_file_name.empty()) {
+    KEYERROR("-b", "No lexer output file specified with -d!")
+  }
+  if (pipeline && !dump_file_name.empty()) {
+    KEYERROR("-p", "The lexer output isn't kept to dump!")
+  }
+  if (coroutine && !dump_file_name.empty()) {
+    KEYERROR("-c", "The lexer output isn't kept to dump!")
+  }
+  if (pipeline && coroutine) {
+    KEYERROR("-c", "Can't be used with -p!")
+  }
+  if (output_file_name.empty()) {
+    output_file_name = "parser_" + input_file_name;
+  }
+
+  // lex and parse at once
+  if (pipeline || coroutine) {
+    Lexer lx(predefined_lexem());
+    Parser x(lx.predefined());
+#ifdef TRANSLATOR_COROUTINES
+    const bool read = coroutine ? coroutine_parse(lx, x, input_file_name)
+                                : pipeline_parse(lx, x, input_file_name);
+#else
+    const bool read = pipeline_parse(lx, x, input_file_name);
+#endif
+    if (!read) {
+      return 0;
+    }
+    std::ofstream output(output_file_name);
+    if (use_std_cout) {
+      x.print();
+    }
+    x.print(output);
+    return 0;
+  }
+
+  // lex file
+  Lexer lx(predefined_lexem());
+  LexemData lexems = lx(input_file_name);
+  if (!dump_file_name.empty()) {
+    if (binary) {
+      std::ofstream dump(dump_file_name, std::ios::binary);
+      write_lexem_file(lexems, dump);
+    } else {
+      std::ofstream dump(dump_file_name);
+      print_results(lexems, dump);
+    }
+  }
+
+  // parse tokens
+  Parser x(std::move(lexems));
+  x.parse();
+  std::ofstream output(output_file_name);
+
+  if (use_std_cout) {
+    x.print();
+  }
+  x.print(output);
+  return 0;
+}
@@ -0,0 +1,83 @@
+/* Lexing and parsing at once instead of one after the other */
+#pragma once
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "lexer.h"
+#include "lexer_generator.h"
+#include "parser.h"
+#include "token_ring.h"
+
+namespace translator {
+
+/// Lex a file on a second thread while the calling thread parses its
+/// tokens as they come, through a ring of ring_size tokens, so the two
+/// phases overlap and the token list is never held whole. parser must
+/// have been made with the lexer's codes, e.g. Parser(lexer.predefined()).
+/// Lexer errors, then syntax errors, are printed to errors, as when the
+/// phases run one after the other. Returns false if the file can't be
+/// read.
+inline bool pipeline_parse(Lexer& lexer,
+                           Parser& parser,
+                           const std::string& filename,
+                           std::ostream& errors = std::cout,
+                           const std::size_t ring_size = 4096) {
+  std::ostringstream lexer_errors;
+  std::ostringstream syntax_errors;
+  lexer.set_error_output(lexer_errors);
+  parser.set_error_output(syntax_errors);
+  LexerAutomaton* automaton = lexer.open(filename);
+  if (automaton == nullptr) {
+    errors << lexer_errors.str();
+    return false;
+  }
+  TokenRing ring(ring_size);
+  std::thread producer([automaton, &ring]() {
+    LexemToken token;
+    bool reading = true;
+    // the rest of the source is still lexed for its errors once the
+    // parser has left
+    while (automaton->next_token(token)) {
+      if (reading) {
+        reading = ring.push(token);
+      }
+    }
+    ring.close();
+  });
+  parser.parse(ring);
+  producer.join();
+  errors << lexer_errors.str() << syntax_errors.str();
+  return true;
+}
+
+#ifdef TRANSLATOR_COROUTINES
+/// Parse a file on the calling thread, lexing each token only when the
+/// parser asks for it through a coroutine, so neither a second thread nor
+/// the token list is needed. Arguments and output are as for
+/// pipeline_parse().
+inline bool coroutine_parse(Lexer& lexer,
+                            Parser& parser,
+                            const std::string& filename,
+                            std::ostream& errors = std::cout) {
+  std::ostringstream lexer_errors;
+  std::ostringstream syntax_errors;
+  lexer.set_error_output(lexer_errors);
+  parser.set_error_output(syntax_errors);
+  LexerAutomaton* automaton = lexer.open(filename);
+  if (automaton == nullptr) {
+    errors << lexer_errors.str();
+    return false;
+  }
+  TokenGenerator tokens = lex_tokens(*automaton);
+  auto pull = [&tokens](LexemToken& token) { return tokens.next(token); };
+  parser.parse_pulled(pull);
+  // the rest of the source is still lexed for its errors
+  LexemToken rest;
+  while (tokens.next(rest)) {
+  }
+  errors << lexer_errors.str() << syntax_errors.str();
+  return true;
+}
+#endif
+}  // namespace translator